@@ -0,0 +1,98 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: bench/normals.cpp
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    Times face normals worked out a triangle at a time,
+    over a surface of triangles, against the vectorized
+    pass over the same surface kept as structure of
+    arrays. The faces come from a wavy heightfield, two
+    per cell.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <chrono>
+
+#include "vox/triangle.h"
+#include "vox/surface.h"
+#include "vox/soa_surface.h"
+
+namespace
+{
+  using surface_t = vox::surface<vox::triangle_p>;
+  using soa_surface_t = vox::soa_surface<vox::triangle_p>;
+
+  vox::vertex_p point(size_t const x, size_t const z)
+  {
+    float const y{ 12.0f * std::sin(x * 0.13f) * std::cos(z * 0.11f) +
+                   4.0f * std::sin((x + z) * 0.37f) };
+    return { { static_cast<float>(x), y, static_cast<float>(z) } };
+  }
+
+  std::vector<vox::triangle_p> gather(size_t const size)
+  {
+    std::vector<vox::triangle_p> tris;
+    tris.reserve(size * size * 2);
+    for(size_t x{}; x < size; ++x)
+    {
+      for(size_t z{}; z < size; ++z)
+      {
+        tris.emplace_back(point(x, z), point(x, z + 1), point(x + 1, z + 1));
+        tris.emplace_back(point(x, z), point(x + 1, z + 1), point(x + 1, z));
+      }
+    }
+    return tris;
+  }
+
+  template <typename Func>
+  double run(size_t const count, size_t const passes, Func const &func)
+  {
+    auto const start(std::chrono::steady_clock::now());
+    for(size_t pass{}; pass < passes; ++pass)
+    { func(); }
+    auto const elapsed(std::chrono::steady_clock::now() - start);
+    return std::chrono::duration<double, std::nano>(elapsed).count() / (count * passes);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  size_t const size{ argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 512 };
+  size_t const passes{ argc > 2 ? static_cast<size_t>(std::atoi(argv[2])) : 20 };
+  auto const tris(gather(size));
+  std::printf("%zu triangles, %zu passes, %s kernel\n", tris.size(), passes,
+              vox::normals::get_kernel_name());
+
+  int32_t const extent{ static_cast<int32_t>(size) };
+  vox::region const reg{ { 0, 0, 0 }, { extent, 1, extent } };
+  surface_t surface(reg);
+  surface.add_triangles(tris.begin(), tris.end());
+  soa_surface_t soa(reg);
+  soa.add_triangles(tris.begin(), tris.end());
+
+  double const single_ns{ run(tris.size(), passes, [&]{ surface.calculate_normals(); }) };
+  double const soa_ns{ run(tris.size(), passes, [&]{ soa.calculate_normals(); }) };
+
+  std::printf("single: %.2f ns/triangle\n", single_ns);
+  std::printf("soa:    %.2f ns/triangle (%.2fx)\n", soa_ns, single_ns / soa_ns);
+
+  /* Both divide the same cross product by the same length. */
+  auto const &single(surface.get_triangles());
+  for(size_t i{}; i < tris.size(); ++i)
+  {
+    auto const &n(single[i].normal);
+    auto const s(soa.get_normal(i));
+    if(n.x != s.x || n.y != s.y || n.z != s.z)
+    {
+      std::printf("normal %zu differs\n", i);
+      return 1;
+    }
+  }
+}
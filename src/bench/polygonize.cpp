@@ -0,0 +1,154 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: bench/polygonize.cpp
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    Times the table driven polygonizer against the per case
+    emitters over the active cells of a noisy terrain. Only
+    polygonization is measured; the cells are classified
+    and sampled up front.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <chrono>
+
+#include "vox/polygonize.h"
+#include "vox/grid_cell.h"
+#include "vox/vertex.h"
+
+namespace
+{
+  /* No face normal; only polygonization is being timed. */
+  struct triangle
+  {
+    using vertex_t = vox::vertex_p;
+
+    triangle(vertex_t const &v0, vertex_t const &v1, vertex_t const &v2)
+      : verts{ v0, v1, v2 }
+    { }
+
+    vertex_t verts[3];
+  };
+
+  struct cell
+  {
+    vox::grid_cell<float> grid;
+    int32_t cube_index;
+  };
+
+  float const iso_level{ 0.0f };
+
+  float sample(size_t const x, size_t const y, size_t const z)
+  {
+    return 40.0f + 12.0f * std::sin(x * 0.13f) * std::cos(z * 0.11f) +
+           4.0f * std::sin((x + y * 2 + z) * 0.37f) - static_cast<float>(y);
+  }
+
+  std::vector<cell> gather(size_t const size)
+  {
+    std::vector<cell> cells;
+    for(size_t x{}; x < size; ++x)
+    {
+      for(size_t y{}; y < size / 2; ++y)
+      {
+        for(size_t z{}; z < size; ++z)
+        {
+          cell c;
+          c.cube_index = 0;
+          for(size_t i{}; i < 8; ++i)
+          {
+            auto &p(c.grid.p[i]);
+            p.x = static_cast<float>(x + corner_table[i][0]);
+            p.y = static_cast<float>(y + corner_table[i][1]);
+            p.z = static_cast<float>(z + corner_table[i][2]);
+            c.grid.val[i] = sample(x + corner_table[i][0], y + corner_table[i][1],
+                                   z + corner_table[i][2]);
+            if(c.grid.val[i] < iso_level)
+            { c.cube_index |= 1 << i; }
+          }
+          if(edge_table[c.cube_index])
+          { cells.push_back(c); }
+        }
+      }
+    }
+    return cells;
+  }
+
+  struct checksum
+  {
+    void operator ()(triangle const &tri)
+    {
+      ++count;
+      for(auto const &v : tri.verts)
+      { sum += v.p.x + v.p.y * 3.0f + v.p.z * 7.0f; }
+    }
+
+    size_t count{};
+    double sum{};
+  };
+
+  struct by_tables
+  {
+    template <typename Make>
+    void operator ()(int32_t const cube_index, Make const &make, checksum &sink) const
+    { vox::polygonize_tables<triangle>(cube_index, make, sink); }
+  };
+  struct by_cases
+  {
+    template <typename Make>
+    void operator ()(int32_t const cube_index, Make const &make, checksum &sink) const
+    { vox::polygonize_cases<triangle>(cube_index, make, sink); }
+  };
+
+  template <typename Polygonize>
+  double run(std::vector<cell> const &cells, size_t const passes,
+             checksum &check, Polygonize const &polygonize)
+  {
+    auto const start(std::chrono::steady_clock::now());
+    for(size_t pass{}; pass < passes; ++pass)
+    {
+      for(auto const &c : cells)
+      {
+        auto const &g(c.grid);
+        auto const make([&g](size_t const a, size_t const b)
+        {
+          float const mu{ (iso_level - g.val[a]) / (g.val[b] - g.val[a]) };
+          return vox::vertex_p{ { g.p[a].x + mu * (g.p[b].x - g.p[a].x),
+                                  g.p[a].y + mu * (g.p[b].y - g.p[a].y),
+                                  g.p[a].z + mu * (g.p[b].z - g.p[a].z) } };
+        });
+        polygonize(c.cube_index, make, check);
+      }
+    }
+    auto const elapsed(std::chrono::steady_clock::now() - start);
+    return std::chrono::duration<double, std::nano>(elapsed).count() /
+           (cells.size() * passes);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  size_t const size{ argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 128 };
+  size_t const passes{ argc > 2 ? static_cast<size_t>(std::atoi(argv[2])) : 20 };
+  auto const cells(gather(size));
+  std::printf("%zu active cells, %zu passes\n", cells.size(), passes);
+
+  checksum tables, cases;
+  double const tables_ns{ run(cells, passes, tables, by_tables{}) };
+  double const cases_ns{ run(cells, passes, cases, by_cases{}) };
+
+  std::printf("tables: %.2f ns/cell\n", tables_ns);
+  std::printf("cases:  %.2f ns/cell (%.2fx)\n", cases_ns, tables_ns / cases_ns);
+  if(tables.count != cases.count || tables.sum != cases.sum)
+  {
+    std::printf("output differs: %zu vs %zu triangles\n", tables.count, cases.count);
+    return 1;
+  }
+}
@@ -10,17 +10,26 @@
 #include "game.h"
 
 #include <iostream>
+#include <string>
 #include <vector>
 #include <chrono>
 #include <limits>
 #include <cmath>
+#include <algorithm>
 
 #include <OgreVector3.h>
 #include <OgreImage.h>
 #include <OgreMaterialManager.h>
+#include <OgreResourceGroupManager.h>
 
 #include "vox/fixed_volume.h"
+#include "vox/volume_file.h"
+#include "vox/heightfield_volume.h"
+#include "vox/generators.h"
 #include "vox/surface_extractor.h"
+#include "vox/incremental_mesher.h"
+#include "vox/surface_net_extractor.h"
+#include "vox/classify.h"
 #include "vox/triangle.h"
 #include "vox/vertex.h"
 
@@ -33,6 +42,7 @@
 #include "ui/server.h"
 
 #include "notif/pool.h"
+#include "util/thread_pool.h"
 
 #include "log/logger.h"
 
@@ -42,6 +52,12 @@ game::game()
 
 game::~game()
 {
+  /* The renderables go before the scene does. */
+  for(auto &section : m_sections)
+  {
+    if(section.renderable && section.renderable->getParentSceneNode())
+    { section.renderable->getParentSceneNode()->detachObject(section.renderable.get()); }
+  }
 }
 
 void game::create_scene()
@@ -49,8 +65,20 @@ void game::create_scene()
   log_info("creating scene");
   log_scoped_push();
 
+  /* The voxelized heightmap is cached on disk, keyed by the
+   * heightmap's bytes and by how they're voxelized; bump the
+   * version whenever the voxelization below changes. */
+  uint32_t constexpr const voxelizer_version{ 1 };
+  std::string const cache_path{ "heightmap.vol" };
+
+  auto stream(Ogre::ResourceGroupManager::getSingleton().openResource("heightmap.jpg", "General"));
+  auto const bytes(stream->getAsString());
+  stream->seek(0);
+  auto const source_hash(vox::volume_file::hash(bytes.data(), bytes.size(),
+                         vox::volume_file::hash(&voxelizer_version, sizeof(voxelizer_version))));
+
   Ogre::Image img;
-  img.load("heightmap.jpg", "General");
+  img.load(stream, "jpg");
   log_info("heightmap size: %%x%%", img.getWidth(), img.getHeight());
 
   log_info("voxelizing...");
@@ -62,38 +90,47 @@ void game::create_scene()
   log_info("scale: %%", scale);
 
   auto const start(std::chrono::system_clock::now());
-  m_volume.reset(new vox::fixed_volume<uint8_t>({ size, static_cast<size_t>(256 * 1.5f), size },
-  [&](vox::fixed_volume<uint8_t> &vol, size_t const start_x, size_t const end_x)
+  vox::region const bounds{ size, static_cast<size_t>(256 * 1.5f), size };
+  vox::volume_file cached{ cache_path, vox::fixed_volume<uint8_t>::get_key(bounds, source_hash) };
+  if(cached.is_open())
   {
-    auto const width(end_x - start_x);
-    size_t const region_height(vol.get_region().get_height());
-    size_t const region_depth(vol.get_region().get_depth());
-
-    for(size_t x{ start_x }; x < width + start_x; ++x)
-    {
-      for(size_t y{}; y < region_height; ++y)
-      {
-        for(size_t z{}; z < region_depth; ++z)
-        {
-          auto const col(img.getColourAt((x / scale), (z / scale), 0).r / 2.0f);
-          vol[x][y][z] = (y <= size * col) ? 255 : 0;
-        }
-      }
-    }
-  }));
+    log_info("mapping cached volume");
+    m_volume.reset(new vox::fixed_volume<uint8_t>(bounds, std::move(cached)));
+  }
+  else
+  {
+    /* The heightmap only varies along x and z, so it's sampled once
+     * per column; the volume is then generated a z run at a time
+     * from those heights. */
+    vox::heightfield_volume<uint8_t> const heights{ bounds,
+    [&](size_t const x, size_t const z)
+    { return size * (img.getColourAt((x / scale), (z / scale), 0).r / 2.0f); } };
+
+    m_volume.reset(new vox::fixed_volume<uint8_t>(bounds,
+          vox::heightfield_generator<vox::heightfield_volume<uint8_t>>{ heights },
+          util::thread_pool::global()));
+    log_info("caching volume");
+    m_volume->save(cache_path, source_hash);
+  }
   auto const end(std::chrono::system_clock::now());
   log_pop();
   log_info("voxelized: %%ms",
       std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count());
 
+  /* Coarse unit sizes and levels of detail read from these. */
+  auto const mips_start(std::chrono::system_clock::now());
+  m_volume->build_mips(m_mip_levels, util::thread_pool::global());
+  log_info("built %% mip levels: %%ms", m_volume->get_mip_count() - 1,
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now() - mips_start).count());
+
   m_camera->setPosition(Ogre::Vector3(-size, size, size));
   auto const size2(size >> 1);
   m_camera->lookAt(Ogre::Vector3(size2, 0.0f, size2));
 
-  m_ogre_volume = m_scene_mgr->createManualObject("terrain");
-  m_ogre_volume->setDynamic(true);
+  log_info("classification kernel: %%", vox::classify::get_kernel_name());
+  m_terrain_node = m_scene_mgr->getRootSceneNode()->createChildSceneNode("terrain");
   update_surface();
-  m_scene_mgr->getRootSceneNode()->createChildSceneNode()->attachObject(m_ogre_volume);
 
   log_info("initializing lighting");
   Ogre::Light * const light{ m_scene_mgr->createLight("MainLight") };
@@ -107,48 +144,226 @@ void game::create_scene()
   log_info("scene created");
 }
 
+/* Packs a surface over reg relative to its lower corner; in holds
+ * count vertices or triangles, which make up the given vertices. */
+template <typename In>
+void game::pack_mesh(chunk_mesh &mesh, In const *in, size_t const count,
+                     size_t const vertices, vox::region const &reg) const
+{
+  mesh.origin = Ogre::Vector3(reg.lower_corner.x, reg.lower_corner.y, reg.lower_corner.z);
+  mesh.compact = m_compact_vertices;
+  if(count == 0)
+  { return; }
+
+  if(mesh.compact)
+  {
+    mesh.step = vox::quantize::step_for(reg);
+    mesh.compact_vertices.resize(vertices);
+    terrain_renderable::pack(in, count, mesh.origin, mesh.step,
+                             mesh.compact_vertices.data(), mesh.bounds);
+  }
+  else
+  {
+    mesh.vertices.resize(vertices);
+    terrain_renderable::pack(in, count, m_volume->get_region().get_width(),
+                             mesh.origin, mesh.vertices.data(), mesh.bounds);
+  }
+}
+
+/* Meshing runs as a job, off the render thread; frame_rendering_queued
+ * uploads what comes back. Jobs run one at a time and only they touch
+ * the mesher, so each sees the volume whole; edits to the volume need
+ * to be submitted as jobs as well. */
 void game::update_surface()
 {
-  int32_t const size{ static_cast<int32_t>(m_volume->get_region().get_width()) };
+  bool const surface_nets{ m_surface_nets };
+  size_t const unit{ m_unit_size };
+  auto const eye(get_eye());
+  m_mesh_jobs.submit([this, surface_nets, unit, eye]() -> std::unique_ptr<mesh_snapshot>
+  {
+    auto &pool(util::thread_pool::global());
+
+    /* Surface nets aren't chunked; the whole volume is extracted.
+     * Dirty voxels are left for the mesher to pick up later. */
+    if(surface_nets)
+    {
+      net_extractor_t const extractor{ *m_volume, m_volume->get_region(), 128, unit };
+      auto const net(extractor(pool));
+      auto const &vertices(net.get_vertices());
+      std::shared_ptr<chunk_mesh> mesh{ std::make_shared<chunk_mesh>() };
+      pack_mesh(*mesh, vertices.data(), vertices.size(), vertices.size(),
+                m_volume->get_region());
+      mesh->indices.assign(net.get_indices().begin(), net.get_indices().end());
+      m_packed_chunks.assign(1, mesh);
+      return std::unique_ptr<mesh_snapshot>{ new mesh_snapshot(m_packed_chunks) };
+    }
+
+    /* A new unit size moves the whole lattice; otherwise only
+     * the chunks touching written voxels need extracting. */
+    if(!m_mesher)
+    {
+      m_mesher.reset(new mesher_t(*m_volume, 128, unit, 64, m_lod_levels));
+      m_mesher->set_simplification(m_simplify_ratio, m_simplify_error);
+      m_mesher->select_lod(eye, m_lod_distance);
+      m_mesher->rebuild(pool);
+    }
+    else if(m_mesher->get_unit_size() != unit)
+    {
+      m_mesher->set_unit_size(unit);
+      m_mesher->select_lod(eye, m_lod_distance);
+      m_mesher->rebuild(pool);
+    }
+    else
+    {
+      auto const changed(m_mesher->update(m_volume->take_dirty(), pool));
+      log_debug("remeshed chunks: %%", changed.size());
+    }
+
+    return pack_chunks();
+  });
+}
+
+/* Chunks change level as the camera moves; checked as a job of its
+ * own whenever the others are done. */
+void game::update_lod()
+{
+  if(m_surface_nets || m_mesh_jobs.is_busy())
+  { return; }
+
+  auto const eye(get_eye());
+  m_mesh_jobs.submit([this, eye]() -> std::unique_ptr<mesh_snapshot>
+  {
+    if(!m_mesher ||
+       m_mesher->update_lod(eye, m_lod_distance, util::thread_pool::global()).empty())
+    { return nullptr; }
+    return pack_chunks();
+  });
+}
+
+/* Runs on the mesh jobs, between extractions, which write into the
+ * mesher's chunks in place. Only chunks whose generation has moved
+ * on since the last snapshot are packed again. */
+std::unique_ptr<game::mesh_snapshot> game::pack_chunks()
+{
+  size_t const chunks{ m_mesher->get_chunk_count() };
+  m_packed_chunks.resize(chunks);
 
-  vox::surface_extractor<vox::triangle_p,
-                         vox::fixed_volume<uint8_t>> extractor
-                           { *m_volume, m_volume->get_region(), 128, m_unit_size };
-  vox::surface<vox::triangle_p> surface{ extractor() };
-  log_debug("triangles: %%", surface.get_triangles().size());
+  size_t packed{}, total{};
+  for(size_t c{}; c < chunks; ++c)
+  {
+    auto const &chunk(m_mesher->get_chunk(c));
+    auto const generation(m_mesher->get_chunk_generation(c));
+    auto const &triangles(chunk.get_triangles());
+    total += triangles.size();
+    if(m_packed_chunks[c] && m_packed_chunks[c]->generation == generation)
+    { continue; }
+
+    std::shared_ptr<chunk_mesh> mesh{ std::make_shared<chunk_mesh>() };
+    mesh->generation = generation;
+    pack_mesh(*mesh, triangles.data(), triangles.size(), triangles.size() * 3,
+              chunk.get_region());
+    m_packed_chunks[c] = mesh;
+    ++packed;
+  }
+  log_debug("packed chunks: %%/%%, triangles: %%", packed, chunks, total);
+  return std::unique_ptr<mesh_snapshot>{ new mesh_snapshot(m_packed_chunks) };
+}
 
-  m_ogre_volume->clear();
-  m_ogre_volume->begin("splat", Ogre::RenderOperation::OT_TRIANGLE_LIST);
+/* Finds the chunks of m_upload which differ from what's shown. */
+void game::begin_upload()
+{
+  m_upload_chunks.clear();
+  m_upload_renderables.clear();
+  m_upload_chunk = m_upload_item = 0;
+  for(size_t c{}; c < std::max(m_upload->size(), m_sections.size()); ++c)
+  {
+    auto const mesh(c < m_upload->size() ? (*m_upload)[c] : nullptr);
+    if(c >= m_sections.size() || m_sections[c].mesh != mesh)
+    { m_upload_chunks.push_back(c); }
+  }
+  m_upload_renderables.resize(m_upload_chunks.size());
+}
 
-  auto const &triangles(surface.get_triangles());
-  for(size_t i(0); i < triangles.size(); ++i)
+/* Copies up to budget more vertices and indices of the changed chunks
+ * into their new renderables, a lock and memcpy each; returns whether
+ * they're all there. */
+bool game::upload_surface(size_t const budget)
+{
+  size_t left{ budget };
+  for(; m_upload_chunk < m_upload_chunks.size() && left; ++m_upload_chunk)
   {
-    for(size_t k(0); k < 3; ++k)
+    auto const c(m_upload_chunks[m_upload_chunk]);
+    if(c >= m_upload->size() || !(*m_upload)[c]->get_vertex_count())
+    { continue; }
+
+    auto const &mesh(*(*m_upload)[c]);
+    size_t const vertices{ mesh.get_vertex_count() };
+    auto &renderable(m_upload_renderables[m_upload_chunk]);
+    if(!renderable)
     {
-      m_ogre_volume->position(triangles[i].verts[k].p.x,
-                              triangles[i].verts[k].p.y,
-                              triangles[i].verts[k].p.z);
-
-      m_ogre_volume->textureCoord(triangles[i].verts[k].p.x * 0.001f,
-                                  triangles[i].verts[k].p.z * 0.001f);
-
-      auto const h(std::min(1.0f, triangles[i].verts[k].p.y / (size * 0.3f)));
-      auto const h_inv(std::max(0.0f, 0.3f - h));
-
-      if(triangles[i].verts[k].p.y > (size * 0.2f))
-      { m_ogre_volume->colour(h, h_inv, 0.0f); }
-      else if(triangles[i].verts[k].p.y > (size * 0.1f))
-      { m_ogre_volume->colour(h, h, 0.0f); }
-      else
-      { m_ogre_volume->colour(0.0f, 0.0f, h); }
-
-      m_ogre_volume->normal(triangles[i].normal.x,
-                            triangles[i].normal.y,
-                            triangles[i].normal.z);
+      renderable.reset(new terrain_renderable(mesh.compact ? terrain_renderable::format::compact
+                                                           : terrain_renderable::format::full));
+      renderable->reserve(vertices, mesh.indices.size());
     }
+
+    if(m_upload_item < vertices)
+    {
+      size_t const count{ std::min(left, vertices - m_upload_item) };
+      renderable->write_vertices(mesh.get_vertices(m_upload_item), m_upload_item, count);
+      m_upload_item += count;
+      left -= count;
+    }
+    if(m_upload_item >= vertices && left)
+    {
+      size_t const first{ m_upload_item - vertices };
+      size_t const count{ std::min(left, mesh.indices.size() - first) };
+      renderable->write_indices(mesh.indices.data() + first, first, count);
+      m_upload_item += count;
+      left -= count;
+    }
+    if(m_upload_item < vertices + mesh.indices.size())
+    { break; }
+
+    renderable->commit(vertices, mesh.indices.size(), mesh.bounds, mesh.step);
+    m_upload_item = 0;
   }
+  return m_upload_chunk == m_upload_chunks.size();
+}
+
+/* Swaps every changed chunk in at once, so seams between levels of
+ * detail never show half updated. */
+void game::end_upload()
+{
+  if(m_sections.size() < m_upload->size())
+  { m_sections.resize(m_upload->size()); }
+  while(m_chunk_nodes.size() < m_upload->size())
+  { m_chunk_nodes.push_back(m_terrain_node->createChildSceneNode()); }
 
-  m_ogre_volume->end();
+  for(size_t i{}; i < m_upload_chunks.size(); ++i)
+  {
+    auto const c(m_upload_chunks[i]);
+    auto &section(m_sections[c]);
+    if(section.renderable)
+    { m_chunk_nodes[c]->detachObject(section.renderable.get()); }
+
+    section.renderable = std::move(m_upload_renderables[i]);
+    section.mesh = c < m_upload->size() ? (*m_upload)[c] : nullptr;
+    if(section.renderable)
+    {
+      m_chunk_nodes[c]->setPosition(section.mesh->origin);
+      m_chunk_nodes[c]->attachObject(section.renderable.get());
+    }
+  }
+  m_sections.resize(m_upload->size());
+  m_upload_chunks.clear();
+  m_upload_renderables.clear();
+  m_upload.reset();
+}
+
+vox::vec3<float> game::get_eye() const
+{
+  auto const &eye(m_camera->getDerivedPosition());
+  return { eye.x, eye.y, eye.z };
 }
 
 bool game::key_pressed(OIS::KeyEvent const &arg)
@@ -168,6 +383,12 @@ bool game::key_pressed(OIS::KeyEvent const &arg)
     update_surface();
     log_debug("unit size: %%", m_unit_size);
   }
+  else if(arg.key == OIS::KC_N)
+  {
+    m_surface_nets = !m_surface_nets;
+    update_surface();
+    log_debug("extractor: %%", m_surface_nets ? "surface nets" : "marching cubes");
+  }
 
   m_camera_mgr->injectKeyDown(arg);
 
@@ -189,6 +410,20 @@ bool game::frame_rendering_queued(Ogre::FrameEvent const &evt)
 {
   m_ui_server->update();
 
+  update_lod();
+
+  /* The newest snapshot's changed chunks are copied into new
+   * renderables over as many frames as the budget needs, then
+   * swapped in together. */
+  if(!m_upload)
+  {
+    m_upload = m_mesh_jobs.take();
+    if(m_upload)
+    { begin_upload(); }
+  }
+  if(m_upload && upload_surface(m_upload_budget))
+  { end_upload(); }
+
   /* Process events. */
   auto &events(notif::pool::get());
   while(events.poll());
@@ -1,13 +1,20 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 #include <cstdint>
 
-#include <OgreManualObject.h>
+#include <OgreAxisAlignedBox.h>
+#include <OgreSceneNode.h>
 
 #include "application.h"
+#include "terrain_renderable.h"
 #include "vox/fixed_volume.h"
+#include "vox/incremental_mesher.h"
+#include "vox/surface_net_extractor.h"
+#include "vox/triangle.h"
 #include "util/borrowed_ptr.h"
+#include "util/job_queue.h"
 
 namespace ui
 { class server; }
@@ -31,12 +38,86 @@ class game : public application
     bool frame_rendering_queued(Ogre::FrameEvent const &evt) override;
 
   private:
+    using mesher_t = vox::incremental_mesher<vox::triangle_pn, vox::fixed_volume<uint8_t>>;
+    using net_extractor_t = vox::surface_net_extractor<vox::vertex_pn, vox::fixed_volume<uint8_t>>;
+    using net_surface_t = net_extractor_t::indexed_surface_t;
+
+    /* A chunk's mesh, packed relative to its origin and ready to
+     * copy in. Chunks which haven't changed share these between
+     * snapshots, so comparing pointers finds the ones which did. */
+    struct chunk_mesh
+    {
+      size_t get_vertex_count() const
+      { return compact ? compact_vertices.size() : vertices.size(); }
+      void const* get_vertices(size_t const first) const
+      {
+        return compact ? static_cast<void const*>(compact_vertices.data() + first)
+                       : static_cast<void const*>(vertices.data() + first);
+      }
+
+      /* The mesher's generation of the chunk packed; see
+       * incremental_mesher::get_chunk_generation. */
+      size_t generation{};
+      Ogre::Vector3 origin;
+      /* One or the other, by compact. */
+      bool compact{};
+      std::vector<terrain_renderable::vertex> vertices;
+      std::vector<vox::vertex_q> compact_vertices;
+      float step{ 1.0f };
+      /* Empty for a list of triangles. */
+      std::vector<uint32_t> indices;
+      Ogre::AxisAlignedBox bounds;
+    };
+    /* What a mesh job hands back: every chunk, by index. */
+    using mesh_snapshot = std::vector<std::shared_ptr<chunk_mesh const>>;
+
+    /* A chunk as it's shown; empty chunks have no renderable. */
+    struct chunk_section
+    {
+      std::shared_ptr<chunk_mesh const> mesh;
+      std::unique_ptr<terrain_renderable> renderable;
+    };
+
     void update_surface();
+    void update_lod();
+    template <typename In>
+    void pack_mesh(chunk_mesh &mesh, In const *in, size_t const count,
+                   size_t const vertices, vox::region const &reg) const;
+    std::unique_ptr<mesh_snapshot> pack_chunks();
+    void begin_upload();
+    bool upload_surface(size_t const budget);
+    void end_upload();
+    vox::vec3<float> get_eye() const;
     uint8_t query_voxel(vox::vec3<size_t> const &) const;
 
     std::unique_ptr<vox::fixed_volume<uint8_t>> m_volume;
-    borrowed_ptr<Ogre::ManualObject> m_ogre_volume{ nullptr };
+    std::unique_ptr<mesher_t> m_mesher;
+    /* Only touched by the mesh jobs. */
+    mesh_snapshot m_packed_chunks;
+    bool m_surface_nets{ false };
+    /* Each chunk's section hangs off its own node of the grid. */
+    borrowed_ptr<Ogre::SceneNode> m_terrain_node{ nullptr };
+    std::vector<borrowed_ptr<Ogre::SceneNode>> m_chunk_nodes;
+    std::vector<chunk_section> m_sections;
+    /* The changed chunks of the snapshot being uploaded, and their
+     * new renderables; they're all swapped in at once. */
+    std::unique_ptr<mesh_snapshot> m_upload;
+    std::vector<size_t> m_upload_chunks;
+    std::vector<std::unique_ptr<terrain_renderable>> m_upload_renderables;
+    size_t m_upload_chunk{}, m_upload_item{};
+    /* Vertices and indices copied in per frame. */
+    size_t const m_upload_budget{ 1 << 18 };
+    /* Quantized vertices; see vox/quantize.h. */
+    bool const m_compact_vertices{ true };
     size_t m_unit_size{ 16 };
+    size_t const m_lod_levels{ 3 };
+    size_t const m_mip_levels{ 6 };
+    float const m_lod_distance{ 128.0f };
+    float const m_simplify_ratio{ 0.25f };
+    float const m_simplify_error{ 0.02f };
     std::unique_ptr<Ogre::Image> m_heightmap;
     std::unique_ptr<ui::server> m_ui_server;
+    /* Only these touch the mesher. Declared last, so the jobs still
+     * queued run, on destruction, while all they read is there. */
+    util::job_queue<mesh_snapshot> m_mesh_jobs;
 };
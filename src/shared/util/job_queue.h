@@ -0,0 +1,89 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: util/job_queue.h
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    Runs jobs one after another on a thread of their own,
+    so whatever they share is only ever touched by one of
+    them at a time. Each job may produce a result, which
+    replaces any result not yet taken; the results hand
+    off through a single atomic slot, so neither side
+    waits on the other.
+*/
+
+#pragma once
+
+#include <memory>
+#include <atomic>
+#include <utility>
+#include <exception>
+
+#include "thread_pool.h"
+#include "log/logger.h"
+
+namespace util
+{
+  template <typename Result>
+  class job_queue
+  {
+    public:
+      using result_t = Result;
+
+      job_queue() = default;
+      job_queue(job_queue const &) = delete;
+      job_queue& operator =(job_queue const &) = delete;
+
+      /* Queued jobs are run before the thread stops. */
+      ~job_queue()
+      {
+        m_worker.reset();
+        delete m_result.exchange(nullptr);
+      }
+
+      /* func() returns a std::unique_ptr<result_t>, or null when
+       * there's nothing new to publish. */
+      template <typename Func>
+      void submit(Func func)
+      {
+        ++m_pending;
+        m_worker->submit([this, func]
+        {
+          /* However the job ends, it's no longer pending. */
+          struct done
+          {
+            ~done()
+            { --pending; }
+            std::atomic<size_t> &pending;
+          } const guard{ m_pending };
+
+          /* Nobody waits on the job, so a failure is only logged. */
+          try
+          {
+            std::unique_ptr<result_t> result(func());
+            if(result)
+            { delete m_result.exchange(result.release()); }
+          }
+          catch(std::exception const &e)
+          { log_error("job failed: %%", e.what()); }
+          catch(...)
+          { log_error("job failed: unknown exception"); }
+        });
+      }
+
+      /* The latest result, if there's one which hasn't been taken. */
+      std::unique_ptr<result_t> take()
+      { return std::unique_ptr<result_t>(m_result.exchange(nullptr)); }
+
+      /* Whether any job is queued or running. */
+      bool is_busy() const
+      { return m_pending.load() != 0; }
+
+    private:
+      std::unique_ptr<thread_pool> m_worker{ new thread_pool(1) };
+      std::atomic<result_t*> m_result{ nullptr };
+      std::atomic<size_t> m_pending{ 0 };
+  };
+}
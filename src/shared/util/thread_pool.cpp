@@ -0,0 +1,62 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: util/thread_pool.cpp
+  Author: Jesse 'Jeaye' Wilkerson
+*/
+
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace util
+{
+  thread_pool& thread_pool::global()
+  {
+    static thread_pool tp{ std::max(1u, std::thread::hardware_concurrency()) };
+    return tp;
+  }
+
+  thread_pool::thread_pool(size_t const threads)
+  {
+    m_workers.reserve(threads);
+    for(size_t i{}; i < threads; ++i)
+    { m_workers.emplace_back(&thread_pool::work, this); }
+  }
+
+  thread_pool::~thread_pool()
+  {
+    {
+      std::lock_guard<std::mutex> const lock(m_tasks_lock);
+      m_stopping = true;
+    }
+    m_tasks_cond.notify_all();
+
+    for(auto &worker : m_workers)
+    { worker.join(); }
+  }
+
+  void thread_pool::work()
+  {
+    while(true)
+    {
+      task_t task;
+
+      { /* Don't hold the lock while running the task. */
+        std::unique_lock<std::mutex> lock(m_tasks_lock);
+        m_tasks_cond.wait(lock, [this]{ return m_stopping || !m_tasks.empty(); });
+
+        /* Drain what's queued before stopping. */
+        if(m_tasks.empty())
+        { return; }
+
+        task = std::move(m_tasks.front());
+        m_tasks.pop();
+      }
+
+      task();
+    }
+  }
+}
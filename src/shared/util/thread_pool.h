@@ -0,0 +1,157 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: util/thread_pool.h
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    A fixed set of worker threads which run submitted
+    tasks in FIFO order. Results come back as futures.
+    parallel_for() splits a range into small chunks which
+    the workers, and the caller, claim until none are left.
+*/
+
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+#include <type_traits>
+
+namespace util
+{
+  class thread_pool
+  {
+    public:
+      using task_t = std::function<void ()>;
+
+      /* Shared pool, sized to the hardware. */
+      static thread_pool& global();
+
+      explicit thread_pool(size_t const threads);
+      ~thread_pool();
+
+      thread_pool(thread_pool const &) = delete;
+      thread_pool& operator =(thread_pool const &) = delete;
+
+      template <typename Func>
+      std::future<typename std::result_of<Func ()>::type> submit(Func &&func)
+      {
+        using result_t = typename std::result_of<Func ()>::type;
+
+        /* std::function needs something copyable. */
+        auto const task(std::make_shared<std::packaged_task<result_t ()>>(
+                        std::forward<Func>(func)));
+        auto fut(task->get_future());
+        {
+          std::lock_guard<std::mutex> const lock(m_tasks_lock);
+          m_tasks.push([task]{ (*task)(); });
+        }
+        m_tasks_cond.notify_one();
+        return fut;
+      }
+
+      /* Calls func(begin, end) over [0, count) in chunks of grain.
+       * Chunks are claimed off a shared counter, so a slow chunk
+       * holds up nobody else. The caller works too, and returns once
+       * every chunk is done; it doesn't wait on the helpers, so this
+       * is safe to call from within a task. The first exception
+       * thrown by func is rethrown. */
+      template <typename Func>
+      void parallel_for(size_t const count, size_t const grain, Func const &func)
+      {
+        size_t const step(std::max<size_t>(1, grain));
+        size_t const chunks((count + step - 1) / step);
+        if(chunks == 0)
+        { return; }
+
+        auto const state(std::make_shared<parallel_state>(chunks));
+        auto const run([state, &func, count, step]
+        {
+          size_t chunk;
+          while((chunk = state->next.fetch_add(1)) < state->chunks)
+          {
+            if(!state->failed.load())
+            {
+              try
+              {
+                size_t const begin(chunk * step);
+                func(begin, std::min(begin + step, count));
+              }
+              catch(...)
+              { state->fail(std::current_exception()); }
+            }
+            state->finish();
+          }
+        });
+
+        /* Helpers which start after the last chunk is claimed only
+         * touch the shared state, never func. */
+        size_t const helpers(std::min(size(), chunks - 1));
+        for(size_t i{}; i < helpers; ++i)
+        { submit(run); }
+        run();
+
+        state->wait();
+        if(state->error)
+        { std::rethrow_exception(state->error); }
+      }
+
+      size_t size() const
+      { return m_workers.size(); }
+
+    private:
+      struct parallel_state
+      {
+        explicit parallel_state(size_t const c)
+          : chunks(c)
+        { }
+
+        void fail(std::exception_ptr const &e)
+        {
+          bool expected{ false };
+          if(failed.compare_exchange_strong(expected, true))
+          { error = e; }
+        }
+
+        void finish()
+        {
+          if(done.fetch_add(1) + 1 == chunks)
+          {
+            std::lock_guard<std::mutex> const lock(done_lock);
+            done_cond.notify_all();
+          }
+        }
+
+        void wait()
+        {
+          std::unique_lock<std::mutex> lock(done_lock);
+          done_cond.wait(lock, [this]{ return done.load() == chunks; });
+        }
+
+        size_t const chunks;
+        std::atomic<size_t> next{ 0 }, done{ 0 };
+        std::atomic<bool> failed{ false };
+        std::exception_ptr error;
+        std::mutex done_lock;
+        std::condition_variable done_cond;
+      };
+
+      void work();
+
+      std::vector<std::thread> m_workers;
+      std::queue<task_t> m_tasks;
+      std::mutex m_tasks_lock;
+      std::condition_variable m_tasks_cond;
+      bool m_stopping{ false };
+  };
+}
@@ -0,0 +1,190 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/bit_volume.h
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    A dense volume of solid or empty voxels, stored as
+    one bit each. Every (x, y) column is packed along z
+    into 64-bit words, so the extractors can classify
+    64 cells at a time; see word_query.h.
+*/
+
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <future>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+#include "region.h"
+#include "dirty_tracker.h"
+#include "util/thread_pool.h"
+#include "log/logger.h"
+
+namespace vox
+{
+  template <typename Value>
+  class bit_volume
+  {
+    public:
+      using value_t = Value;
+      using word_t = uint64_t;
+      using fill_func_t = std::function<void (bit_volume&, size_t const, size_t const)>;
+      static size_t constexpr const word_bits{ 64 };
+
+      /* Solid voxels read as solid, the rest as empty. */
+      bit_volume(region const &size,
+                 value_t const solid = std::numeric_limits<value_t>::max(),
+                 value_t const empty = value_t{})
+        : m_region(size)
+        , m_solid(solid)
+        , m_empty(empty)
+        , m_words_z((size.get_depth() + word_bits - 1) / word_bits)
+        , m_words(size.get_width() * size.get_height() * m_words_z)
+        , m_dirty(size.get_width(), size.get_height(), size.get_depth())
+      { }
+
+      /* func(vol, start_x, end_x) is called on the pool for x-slabs of
+       * the volume; every column belongs to one call, so set() is safe. */
+      bit_volume(region const &size, fill_func_t const &func,
+                 value_t const solid = std::numeric_limits<value_t>::max(),
+                 value_t const empty = value_t{})
+        : bit_volume(size, solid, empty)
+      { fill(func); }
+
+      value_t at(size_t const x, size_t const y, size_t const z) const
+      {
+        if(x >= static_cast<size_t>(m_region.get_width()) ||
+           y >= static_cast<size_t>(m_region.get_height()) ||
+           z >= static_cast<size_t>(m_region.get_depth()))
+        { throw std::out_of_range("Voxel index out of volume bounds"); }
+        return (*this)(x, y, z);
+      }
+
+      /* Unchecked access; this is what the extractors use. */
+      value_t operator ()(size_t const x, size_t const y, size_t const z) const
+      { return is_solid(x, y, z) ? m_solid : m_empty; }
+
+      bool is_solid(size_t const x, size_t const y, size_t const z) const
+      { return (m_words[word_index(x, y, z)] >> (z % word_bits)) & 1; }
+
+      /* Doesn't mark anything dirty; fills use this directly. */
+      void set(size_t const x, size_t const y, size_t const z, bool const solid)
+      {
+        auto &word(m_words[word_index(x, y, z)]);
+        word_t const bit{ word_t{ 1 } << (z % word_bits) };
+        word = solid ? (word | bit) : (word & ~bit);
+      }
+
+      /* An edit; marks the voxel dirty if it changed. */
+      void write(size_t const x, size_t const y, size_t const z, bool const solid)
+      {
+        if(is_solid(x, y, z) == solid)
+        { return; }
+        set(x, y, z, solid);
+        m_dirty.mark(x, y, z);
+      }
+
+      /* The boxes written since the last call. */
+      std::vector<region> take_dirty()
+      { return m_dirty.take(); }
+
+      /* Bit i is set if voxel (x, y, z + i) is solid; z needn't be
+       * word aligned. Bits past the volume's depth are clear. */
+      word_t get_bits(size_t const x, size_t const y, size_t const z) const
+      {
+        size_t const index{ word_index(x, y, z) };
+        size_t const shift{ z % word_bits };
+        word_t bits{ m_words[index] >> shift };
+        if(shift && (z / word_bits) + 1 < m_words_z)
+        { bits |= m_words[index + 1] << (word_bits - shift); }
+        return bits;
+      }
+
+      value_t get_solid() const
+      { return m_solid; }
+      value_t get_empty() const
+      { return m_empty; }
+
+      /* Exact; scans the words overlapping the box. See range_query.h. */
+      bool get_range(region const &voxels, value_t &min, value_t &max) const
+      {
+        size_t const lower_x(std::max(voxels.lower_corner.x, 0));
+        size_t const lower_y(std::max(voxels.lower_corner.y, 0));
+        size_t const lower_z(std::max(voxels.lower_corner.z, 0));
+        size_t const upper_x(std::min(voxels.upper_corner.x, m_region.get_width()));
+        size_t const upper_y(std::min(voxels.upper_corner.y, m_region.get_height()));
+        size_t const upper_z(std::min(voxels.upper_corner.z, m_region.get_depth()));
+        if(lower_x >= upper_x || lower_y >= upper_y || lower_z >= upper_z)
+        { return false; }
+
+        bool solid{}, empty{};
+        for(size_t x{ lower_x }; x < upper_x && !(solid && empty); ++x)
+        {
+          for(size_t y{ lower_y }; y < upper_y && !(solid && empty); ++y)
+          {
+            for(size_t z{ lower_z }; z < upper_z; z += word_bits)
+            {
+              size_t const count{ std::min(upper_z - z, word_bits) };
+              word_t const mask{ count == word_bits ? ~word_t{} : (word_t{ 1 } << count) - 1 };
+              word_t const bits{ get_bits(x, y, z) & mask };
+              solid = solid || bits;
+              empty = empty || bits != mask;
+            }
+          }
+        }
+
+        min = max = solid ? m_solid : m_empty;
+        if(solid && empty)
+        {
+          min = std::min(m_solid, m_empty);
+          max = std::max(m_solid, m_empty);
+        }
+        return true;
+      }
+
+      /* Bytes used by the voxels. */
+      size_t get_memory_usage() const
+      { return m_words.size() * sizeof(word_t); }
+
+      region const& get_region() const
+      { return m_region; }
+
+    private:
+      size_t word_index(size_t const x, size_t const y, size_t const z) const
+      { return ((x * m_region.get_height()) + y) * m_words_z + (z / word_bits); }
+
+      void fill(fill_func_t const &func)
+      {
+        log_info("filling bit volume");
+        log_push();
+
+        size_t const width(m_region.get_width());
+        size_t const slab{ 8 };
+        auto &pool(util::thread_pool::global());
+        std::vector<std::future<void>> futs;
+        futs.reserve((width + slab - 1) / slab);
+        for(size_t x{}; x < width; x += slab)
+        {
+          futs.push_back(pool.submit([this, &func, x, width, slab]
+          { func(*this, x, std::min(x + slab, width)); }));
+        }
+        for(auto &f : futs)
+        { f.get(); }
+
+        log_pop();
+        log_info("bit volume filled");
+      }
+
+      region const m_region;
+      value_t const m_solid, m_empty;
+      size_t const m_words_z;
+      std::vector<word_t> m_words;
+      dirty_tracker<> m_dirty;
+  };
+}
@@ -0,0 +1,246 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/classify.cpp
+  Author: Jesse 'Jeaye' Wilkerson
+*/
+
+#include "classify.h"
+
+/* SSE2 is always there on x86-64. AVX2 is compiled per
+ * function and only used if the CPU reports it. */
+#if defined(__x86_64__) && defined(__GNUC__)
+  #define VOX_CLASSIFY_SSE2
+  #define VOX_CLASSIFY_AVX2
+  #include <immintrin.h>
+#endif
+
+namespace vox
+{
+  namespace classify
+  {
+    namespace
+    {
+      using below_t = void (*)(uint8_t const*, size_t const, uint8_t const, uint8_t*);
+      using cube_indices_t = void (*)(uint8_t const*, uint8_t const*, uint8_t const*,
+                                      uint8_t const*, size_t const, uint8_t*);
+      using active_t = size_t (*)(uint8_t const*, size_t const, uint32_t*);
+
+      struct kernel
+      {
+        char const *name;
+        below_t below;
+        cube_indices_t cube_indices;
+        active_t active;
+      };
+
+      /*** Scalar. ***/
+      void below_scalar(uint8_t const *values, size_t const count,
+                        uint8_t const iso, uint8_t *out)
+      { classify::below<uint8_t>(values, count, iso, out); }
+
+      void cube_indices_scalar(uint8_t const *r0, uint8_t const *r1,
+                               uint8_t const *r2, uint8_t const *r3,
+                               size_t const cells, uint8_t *out)
+      {
+        uint8_t lower(r0[0] | (r1[0] << 1) | (r2[0] << 2) | (r3[0] << 3));
+        for(size_t i{}; i < cells; ++i)
+        {
+          uint8_t const upper(r0[i + 1] | (r1[i + 1] << 1) |
+                              (r2[i + 1] << 2) | (r3[i + 1] << 3));
+          out[i] = lower | (upper << 4);
+          lower = upper;
+        }
+      }
+
+      size_t active_scalar(uint8_t const *cubes, size_t const count, uint32_t *out)
+      {
+        size_t found{};
+        for(size_t i{}; i < count; ++i)
+        {
+          if(cubes[i] != 0 && cubes[i] != 255)
+          { out[found++] = static_cast<uint32_t>(i); }
+        }
+        return found;
+      }
+
+#ifdef VOX_CLASSIFY_SSE2
+      /*** SSE2; always present on x86-64. ***/
+      void below_sse2(uint8_t const *values, size_t const count,
+                      uint8_t const iso, uint8_t *out)
+      {
+        __m128i const level(_mm_set1_epi8(static_cast<char>(iso)));
+        __m128i const one(_mm_set1_epi8(1));
+        size_t i{};
+        for(; i + 16 <= count; i += 16)
+        {
+          __m128i const v(_mm_loadu_si128(reinterpret_cast<__m128i const*>(values + i)));
+          /* max(v, iso) == v means v >= iso. */
+          __m128i const at_least(_mm_cmpeq_epi8(_mm_max_epu8(v, level), v));
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_andnot_si128(at_least, one));
+        }
+        below_scalar(values + i, count - i, iso, out + i);
+      }
+
+      void cube_indices_sse2(uint8_t const *r0, uint8_t const *r1,
+                             uint8_t const *r2, uint8_t const *r3,
+                             size_t const cells, uint8_t *out)
+      {
+        /* Flags are 0 or 1, so 16-bit shifts never carry between bytes. */
+        auto const nibble([](uint8_t const *a, uint8_t const *b,
+                             uint8_t const *c, uint8_t const *d, size_t const i)
+        {
+          auto const load([i](uint8_t const *p)
+          { return _mm_loadu_si128(reinterpret_cast<__m128i const*>(p + i)); });
+          return _mm_or_si128(_mm_or_si128(load(a), _mm_slli_epi16(load(b), 1)),
+                              _mm_or_si128(_mm_slli_epi16(load(c), 2),
+                                           _mm_slli_epi16(load(d), 3)));
+        });
+
+        size_t i{};
+        for(; i + 16 <= cells; i += 16)
+        {
+          __m128i const lower(nibble(r0, r1, r2, r3, i));
+          __m128i const upper(nibble(r0, r1, r2, r3, i + 1));
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                           _mm_or_si128(lower, _mm_slli_epi16(upper, 4)));
+        }
+        cube_indices_scalar(r0 + i, r1 + i, r2 + i, r3 + i, cells - i, out + i);
+      }
+
+      size_t active_sse2(uint8_t const *cubes, size_t const count, uint32_t *out)
+      {
+        __m128i const none(_mm_setzero_si128());
+        __m128i const all(_mm_set1_epi8(-1));
+        size_t found{}, i{};
+        for(; i + 16 <= count; i += 16)
+        {
+          __m128i const v(_mm_loadu_si128(reinterpret_cast<__m128i const*>(cubes + i)));
+          int const empty(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, none),
+                                                         _mm_cmpeq_epi8(v, all))));
+          for(unsigned mask(~empty & 0xffff); mask; mask &= mask - 1)
+          { out[found++] = static_cast<uint32_t>(i + __builtin_ctz(mask)); }
+        }
+        size_t const tail(active_scalar(cubes + i, count - i, out + found));
+        for(size_t k{}; k < tail; ++k)
+        { out[found + k] += static_cast<uint32_t>(i); }
+        return found + tail;
+      }
+#endif
+
+#ifdef VOX_CLASSIFY_AVX2
+      /*** AVX2. ***/
+      __attribute__((target("avx2")))
+      void below_avx2(uint8_t const *values, size_t const count,
+                      uint8_t const iso, uint8_t *out)
+      {
+        __m256i const level(_mm256_set1_epi8(static_cast<char>(iso)));
+        __m256i const one(_mm256_set1_epi8(1));
+        size_t i{};
+        for(; i + 32 <= count; i += 32)
+        {
+          __m256i const v(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(values + i)));
+          __m256i const at_least(_mm256_cmpeq_epi8(_mm256_max_epu8(v, level), v));
+          _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                              _mm256_andnot_si256(at_least, one));
+        }
+
+        /* Avoid the AVX to SSE transition penalty in the tail. */
+        _mm256_zeroupper();
+        below_sse2(values + i, count - i, iso, out + i);
+      }
+
+      __attribute__((target("avx2")))
+      __m256i nibble_avx2(uint8_t const *a, uint8_t const *b,
+                          uint8_t const *c, uint8_t const *d, size_t const i)
+      {
+        __m256i const va(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(a + i)));
+        __m256i const vb(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(b + i)));
+        __m256i const vc(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(c + i)));
+        __m256i const vd(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(d + i)));
+        return _mm256_or_si256(_mm256_or_si256(va, _mm256_slli_epi16(vb, 1)),
+                               _mm256_or_si256(_mm256_slli_epi16(vc, 2),
+                                               _mm256_slli_epi16(vd, 3)));
+      }
+
+      __attribute__((target("avx2")))
+      void cube_indices_avx2(uint8_t const *r0, uint8_t const *r1,
+                             uint8_t const *r2, uint8_t const *r3,
+                             size_t const cells, uint8_t *out)
+      {
+        size_t i{};
+        for(; i + 32 <= cells; i += 32)
+        {
+          __m256i const lower(nibble_avx2(r0, r1, r2, r3, i));
+          __m256i const upper(nibble_avx2(r0, r1, r2, r3, i + 1));
+          _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                              _mm256_or_si256(lower, _mm256_slli_epi16(upper, 4)));
+        }
+
+        _mm256_zeroupper();
+        cube_indices_sse2(r0 + i, r1 + i, r2 + i, r3 + i, cells - i, out + i);
+      }
+
+      __attribute__((target("avx2")))
+      size_t active_avx2(uint8_t const *cubes, size_t const count, uint32_t *out)
+      {
+        __m256i const none(_mm256_setzero_si256());
+        __m256i const all(_mm256_set1_epi8(-1));
+        size_t found{}, i{};
+        for(; i + 32 <= count; i += 32)
+        {
+          __m256i const v(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(cubes + i)));
+          unsigned const empty(static_cast<unsigned>(_mm256_movemask_epi8(
+                                _mm256_or_si256(_mm256_cmpeq_epi8(v, none),
+                                                _mm256_cmpeq_epi8(v, all)))));
+          for(unsigned mask(~empty); mask; mask &= mask - 1)
+          { out[found++] = static_cast<uint32_t>(i + __builtin_ctz(mask)); }
+        }
+
+        _mm256_zeroupper();
+        size_t const tail(active_sse2(cubes + i, count - i, out + found));
+        for(size_t k{}; k < tail; ++k)
+        { out[found + k] += static_cast<uint32_t>(i); }
+        return found + tail;
+      }
+#endif
+
+      kernel select()
+      {
+#ifdef VOX_CLASSIFY_AVX2
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx2"))
+        { return { "avx2", below_avx2, cube_indices_avx2, active_avx2 }; }
+#endif
+#ifdef VOX_CLASSIFY_SSE2
+        return { "sse2", below_sse2, cube_indices_sse2, active_sse2 };
+#else
+        return { "scalar", below_scalar, cube_indices_scalar, active_scalar };
+#endif
+      }
+
+      kernel const& get_kernel()
+      {
+        static kernel const k(select());
+        return k;
+      }
+    }
+
+    void below(uint8_t const *values, size_t const count,
+               uint8_t const iso, uint8_t *out)
+    { get_kernel().below(values, count, iso, out); }
+
+    void cube_indices(uint8_t const *r0, uint8_t const *r1,
+                      uint8_t const *r2, uint8_t const *r3,
+                      size_t const cells, uint8_t *out)
+    { get_kernel().cube_indices(r0, r1, r2, r3, cells, out); }
+
+    size_t active(uint8_t const *cubes, size_t const count, uint32_t *out)
+    { return get_kernel().active(cubes, count, out); }
+
+    char const* get_kernel_name()
+    { return get_kernel().name; }
+  }
+}
@@ -0,0 +1,89 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/classify.h
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    Row-at-a-time marching cubes classification. Voxels
+    are flagged against the iso level once each, flag rows
+    are combined into cube indices, and only the cells the
+    surface passes through are reported. The uint8_t paths
+    are vectorized; the kernel is picked at runtime. Bit
+    volumes skip the flags and classify whole words.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+
+namespace vox
+{
+  namespace classify
+  {
+    /* out[i] = values[i] < iso ? 1 : 0 */
+    void below(uint8_t const *values, size_t const count,
+               uint8_t const iso, uint8_t *out);
+    template <typename Value>
+    void below(Value const *values, size_t const count,
+               Value const iso, uint8_t *out)
+    {
+      for(size_t i{}; i < count; ++i)
+      { out[i] = values[i] < iso ? 1 : 0; }
+    }
+
+    /* Builds the cube indices of a row of cells from the below-iso
+     * flags of its four corner rows, as numbered in tables.h:
+     * r0 = (x, y), r1 = (x + 1, y), r2 = (x + 1, y + 1), r3 = (x, y + 1).
+     * Each row holds cells + 1 flags; corners 4-7 are the next flag. */
+    void cube_indices(uint8_t const *r0, uint8_t const *r1,
+                      uint8_t const *r2, uint8_t const *r3,
+                      size_t const cells, uint8_t *out);
+
+    /* Writes the positions of the cells which the surface passes
+     * through (those not entirely in or out) and returns how many. */
+    size_t active(uint8_t const *cubes, size_t const count, uint32_t *out);
+
+    /* Word-at-a-time classification of 64 cells along z, for volumes
+     * which store a bit per voxel. Bit i of corners[c] flags whether
+     * corner c (as numbered in tables.h) of cell i is below the iso
+     * level. Returns a mask of the cells the surface passes through. */
+    inline uint64_t active_cells(uint64_t const (&corners)[8])
+    {
+      uint64_t any{}, all{ ~uint64_t{} };
+      for(size_t c{}; c < 8; ++c)
+      {
+        any |= corners[c];
+        all &= corners[c];
+      }
+      return any & ~all;
+    }
+
+    /* The cube index of cell i, from the same words. */
+    inline uint8_t cube_index(uint64_t const (&corners)[8], size_t const i)
+    {
+      uint8_t index{};
+      for(size_t c{}; c < 8; ++c)
+      { index |= static_cast<uint8_t>(((corners[c] >> i) & 1) << c); }
+      return index;
+    }
+
+    /* The position of the lowest set bit; mask must not be zero. */
+    inline size_t lowest_bit(uint64_t const mask)
+    {
+#if defined(__GNUC__)
+      return static_cast<size_t>(__builtin_ctzll(mask));
+#else
+      size_t i{};
+      while(!((mask >> i) & 1))
+      { ++i; }
+      return i;
+#endif
+    }
+
+    /* Which kernel was selected; for logging. */
+    char const* get_kernel_name();
+  }
+}
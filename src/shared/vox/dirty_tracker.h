@@ -0,0 +1,123 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/dirty_tracker.h
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    Remembers which parts of a volume were written since
+    they were last taken. Writes are bucketed into cubic
+    chunks; each chunk keeps the bounding box of its
+    writes, so a single voxel edit stays a single voxel.
+*/
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "region.h"
+
+namespace vox
+{
+  template <size_t ChunkSize = 16>
+  class dirty_tracker
+  {
+    public:
+      static size_t constexpr const chunk_size{ ChunkSize };
+
+      dirty_tracker(size_t const width, size_t const height, size_t const depth)
+        : m_chunks_y((height + chunk_size - 1) / chunk_size)
+        , m_chunks_z((depth + chunk_size - 1) / chunk_size)
+        , m_boxes(((width + chunk_size - 1) / chunk_size) * m_chunks_y * m_chunks_z)
+      { }
+
+      void mark(size_t const x, size_t const y, size_t const z)
+      {
+        auto const index(chunk_index(x / chunk_size, y / chunk_size, z / chunk_size));
+        auto &b(m_boxes[index]);
+        if(!b.dirty)
+        {
+          b = { true, { to_value(x), to_value(y), to_value(z) },
+                      { to_value(x + 1), to_value(y + 1), to_value(z + 1) } };
+          m_dirty.push_back(index);
+          return;
+        }
+        b.lower.x = std::min(b.lower.x, to_value(x));
+        b.lower.y = std::min(b.lower.y, to_value(y));
+        b.lower.z = std::min(b.lower.z, to_value(z));
+        b.upper.x = std::max(b.upper.x, to_value(x + 1));
+        b.upper.y = std::max(b.upper.y, to_value(y + 1));
+        b.upper.z = std::max(b.upper.z, to_value(z + 1));
+      }
+
+      /* Marks a whole box of voxels. */
+      void mark(region const &voxels)
+      {
+        if(voxels.get_width() == 0 || voxels.get_height() == 0 || voxels.get_depth() == 0)
+        { return; }
+
+        auto const &lower(voxels.lower_corner);
+        auto const &upper(voxels.upper_corner);
+        for(size_t cx(lower.x / chunk_size); cx <= (upper.x - 1) / chunk_size; ++cx)
+        {
+          for(size_t cy(lower.y / chunk_size); cy <= (upper.y - 1) / chunk_size; ++cy)
+          {
+            for(size_t cz(lower.z / chunk_size); cz <= (upper.z - 1) / chunk_size; ++cz)
+            {
+              /* Clip the box to this chunk and mark its corners. */
+              auto const clip([](region::value_t const low, region::value_t const high,
+                                 size_t const c, region::value_t &from, region::value_t &to)
+              {
+                from = std::max(low, static_cast<region::value_t>(c * chunk_size));
+                to = std::min(high, static_cast<region::value_t>((c + 1) * chunk_size)) - 1;
+              });
+              region::value_t fx, tx, fy, ty, fz, tz;
+              clip(lower.x, upper.x, cx, fx, tx);
+              clip(lower.y, upper.y, cy, fy, ty);
+              clip(lower.z, upper.z, cz, fz, tz);
+              mark(fx, fy, fz);
+              mark(tx, ty, tz);
+            }
+          }
+        }
+      }
+
+      bool empty() const
+      { return m_dirty.empty(); }
+
+      /* Hands back the dirty boxes, one per chunk written to,
+       * in the order the chunks were first written. */
+      std::vector<region> take()
+      {
+        std::vector<region> out;
+        out.reserve(m_dirty.size());
+        for(auto const index : m_dirty)
+        {
+          auto &b(m_boxes[index]);
+          out.emplace_back(b.lower, b.upper);
+          b.dirty = false;
+        }
+        m_dirty.clear();
+        return out;
+      }
+
+    private:
+      struct box
+      {
+        bool dirty;
+        vec3<region::value_t> lower, upper;
+      };
+
+      static region::value_t to_value(size_t const v)
+      { return static_cast<region::value_t>(v); }
+
+      size_t chunk_index(size_t const cx, size_t const cy, size_t const cz) const
+      { return ((cx * m_chunks_y) + cy) * m_chunks_z + cz; }
+
+      size_t const m_chunks_y, m_chunks_z;
+      std::vector<box> m_boxes;
+      std::vector<size_t> m_dirty;
+  };
+}
@@ -0,0 +1,106 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/downsample.cpp
+  Author: Jesse 'Jeaye' Wilkerson
+*/
+
+#include "downsample.h"
+
+/* SSE2 is always there on x86-64. */
+#if defined(__x86_64__) && defined(__GNUC__)
+  #define VOX_DOWNSAMPLE_SSE2
+  #include <emmintrin.h>
+#endif
+
+namespace vox
+{
+  namespace downsample
+  {
+    namespace
+    {
+      /* Weights of rows[i]; the product of 1 2 1 along x and y. */
+      uint16_t constexpr const row_weights[9]{ 1, 2, 1, 2, 4, 2, 1, 2, 1 };
+
+      void gather_scalar(uint8_t const * const (&rows)[9], size_t const begin,
+                         size_t const count, uint16_t *out)
+      {
+        for(size_t z{ begin }; z < count; ++z)
+        {
+          uint16_t sum{};
+          for(size_t i{}; i < 9; ++i)
+          { sum += rows[i][z] * row_weights[i]; }
+          out[z] = sum;
+        }
+      }
+
+      /* Sums are at most 16 * 255; the total is at most 64 * 255,
+       * so everything fits in 16 bits. */
+      uint8_t reduce_one(uint16_t const *sums, size_t const length, size_t const z)
+      {
+        size_t const centre{ 2 * z };
+        size_t const lower{ centre ? centre - 1 : 0 };
+        size_t const upper{ centre + 1 < length ? centre + 1 : length - 1 };
+        return static_cast<uint8_t>((sums[lower] + 2 * sums[centre] + sums[upper] + 32) >> 6);
+      }
+    }
+
+    void gather(uint8_t const * const (&rows)[9], size_t const count, uint16_t *out)
+    {
+      size_t z{};
+#ifdef VOX_DOWNSAMPLE_SSE2
+      __m128i const zero(_mm_setzero_si128());
+      for(; z + 16 <= count; z += 16)
+      {
+        __m128i low(zero), high(zero);
+        for(size_t i{}; i < 9; ++i)
+        {
+          __m128i const v(_mm_loadu_si128(reinterpret_cast<__m128i const*>(rows[i] + z)));
+          /* The weights are powers of two. */
+          __m128i const shift(_mm_cvtsi32_si128(row_weights[i] >> 1));
+          low = _mm_add_epi16(low, _mm_sll_epi16(_mm_unpacklo_epi8(v, zero), shift));
+          high = _mm_add_epi16(high, _mm_sll_epi16(_mm_unpackhi_epi8(v, zero), shift));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + z), low);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + z + 8), high);
+      }
+#endif
+      gather_scalar(rows, z, count, out);
+    }
+
+    void reduce(uint16_t const *sums, size_t const length,
+                size_t const first, size_t const last, uint8_t *out)
+    {
+      size_t z{ first };
+#ifdef VOX_DOWNSAMPLE_SSE2
+      /* The first voxel clamps its lower tap; after that, eight at a
+       * time, so long as every upper tap is within the run. */
+      if(z == 0 && z < last)
+      {
+        out[z] = reduce_one(sums, length, z);
+        ++z;
+      }
+      __m128i const low_half(_mm_set1_epi32(0xffff));
+      __m128i const round(_mm_set1_epi16(32));
+      for(; z + 8 <= last && 2 * (z + 7) + 1 < length; z += 8)
+      {
+        __m128i const a(_mm_loadu_si128(reinterpret_cast<__m128i const*>(sums + 2 * z)));
+        __m128i const b(_mm_loadu_si128(reinterpret_cast<__m128i const*>(sums + 2 * z + 8)));
+        /* The sums are below 2^15, so packing them signed is safe. */
+        __m128i const centre(_mm_packs_epi32(_mm_and_si128(a, low_half),
+                                             _mm_and_si128(b, low_half)));
+        __m128i const upper(_mm_packs_epi32(_mm_srli_epi32(a, 16), _mm_srli_epi32(b, 16)));
+        __m128i const lower(_mm_insert_epi16(_mm_slli_si128(upper, 2), sums[2 * z - 1], 0));
+        __m128i const total(_mm_add_epi16(_mm_add_epi16(lower, upper),
+                                          _mm_add_epi16(_mm_slli_epi16(centre, 1), round)));
+        __m128i const mean(_mm_srli_epi16(total, 6));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + z), _mm_packus_epi16(mean, mean));
+      }
+#endif
+      for(; z < last; ++z)
+      { out[z] = reduce_one(sums, length, z); }
+    }
+  }
+}
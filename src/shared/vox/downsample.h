@@ -0,0 +1,40 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/downsample.h
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    Halves runs of uint8_t voxels, for the levels of a
+    mip chain. Each coarse voxel is the mean of the 27
+    around the fine voxel it sits on, weighted 1 2 1
+    along each axis; that's a 2x box filter run twice,
+    but it keeps every coarse voxel on a fine lattice
+    point where a single box would put it half a voxel
+    off. Sums are gathered across x and y first, then
+    reduced along z. Both steps are vectorized.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+
+namespace vox
+{
+  namespace downsample
+  {
+    /* out[z] = the sum of the nine rows at z, weighted 1 2 1 along
+     * both axes. rows are numbered x-major around the centre,
+     * so rows[4] is the run under the coarse voxel. */
+    void gather(uint8_t const * const (&rows)[9], size_t const count, uint16_t *out);
+
+    /* out[z], for z in [first, last), is the rounded mean of
+     * sums[2z - 1], sums[2z] and sums[2z + 1], weighted 1 2 1, where
+     * each sum came from gather(). Taps outside of [0, length)
+     * are clamped; only the sums read need to have been gathered. */
+    void reduce(uint16_t const *sums, size_t const length,
+                size_t const first, size_t const last, uint8_t *out);
+  }
+}
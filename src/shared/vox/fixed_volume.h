@@ -6,112 +6,473 @@
   File: vox/fixed_volume.h
   Author: Jesse 'Jeaye' Wilkerson
   Description:
-    TODO
+    A dense volume backed by a single contiguous
+    allocation, or by a mapped volume_file. The Layout
+    decides how voxels are ordered within it; see layout.h.
+    A chain of downsampled copies can be built on top,
+    for extracting coarse lattices; see mip_view.h.
 */
 
 #pragma once
 
 #include <vector>
+#include <memory>
+#include <string>
 #include <functional>
 #include <future>
+#include <atomic>
+#include <stdexcept>
+#include <algorithm>
+#include <type_traits>
+#include <cmath>
 
 #include "region.h"
+#include "layout.h"
+#include "span.h"
+#include "range_pyramid.h"
+#include "dirty_tracker.h"
+#include "volume_file.h"
+#include "downsample.h"
+#include "util/thread_pool.h"
 #include "log/logger.h"
 
 namespace vox
 {
-  template <typename Value>
+  template <typename Value, typename Layout = layout::xyz>
   class fixed_volume
   {
     public:
       using value_t = Value;
-      using container_t = std::vector<std::vector<std::vector<value_t>>>;
-      using container_index_t = std::vector<std::vector<value_t>>;
+      using layout_t = Layout;
+      using container_t = std::vector<value_t>;
       using fill_func_t = std::function<void (fixed_volume&, size_t const, size_t const)>;
 
+      /* Proxies to keep vol[x][y][z] working on top of flat storage. */
+      template <typename Volume, typename Result>
+      class row_proxy
+      {
+        public:
+          row_proxy(Volume &vol, size_t const x, size_t const y)
+            : m_volume(vol), m_x(x), m_y(y)
+          { }
+
+          Result& operator [](size_t const z) const
+          { return m_volume(m_x, m_y, z); }
+
+        private:
+          Volume &m_volume;
+          size_t const m_x, m_y;
+      };
+      template <typename Volume, typename Result>
+      class slice_proxy
+      {
+        public:
+          slice_proxy(Volume &vol, size_t const x)
+            : m_volume(vol), m_x(x)
+          { }
+
+          row_proxy<Volume, Result> operator [](size_t const y) const
+          { return { m_volume, m_x, y }; }
+
+        private:
+          Volume &m_volume;
+          size_t const m_x;
+      };
+      using container_index_t = slice_proxy<fixed_volume, value_t>;
+      using const_container_index_t = slice_proxy<fixed_volume const, value_t const>;
+
       fixed_volume(region const &size)
         : m_region(size)
-      { fill([](size_t const, size_t const){ return value_t{}; }); }
+        , m_layout(size.get_width(), size.get_height(), size.get_depth())
+        , m_data(m_layout.capacity())
+        , m_voxels(m_data.data())
+        , m_ranges(size.get_width(), size.get_height(), size.get_depth())
+        , m_dirty(size.get_width(), size.get_height(), size.get_depth())
+      { }
 
       fixed_volume(region const &size, fill_func_t const &func)
         : m_region(size)
+        , m_layout(size.get_width(), size.get_height(), size.get_depth())
+        , m_ranges(size.get_width(), size.get_height(), size.get_depth())
+        , m_dirty(size.get_width(), size.get_height(), size.get_depth())
       { fill(func); }
 
+      /* Generates every run of voxels; see generate(). */
+      template <typename Generator>
+      fixed_volume(region const &size, Generator const &gen, util::thread_pool &pool)
+        : fixed_volume(size)
+      {
+        log_info("generating volume");
+        log_push();
+        generate_runs(gen, pool);
+        log_info("building ranges");
+        build_ranges(pool);
+        log_pop();
+        log_info("volume generated");
+      }
+
+      /* Uses an open file, opened with get_key(size, ...), as storage;
+       * nothing is copied, and pages are read in as they're touched.
+       * Only the ranges are built, from the mapped voxels. */
+      fixed_volume(region const &size, volume_file &&file)
+        : m_region(size)
+        , m_layout(size.get_width(), size.get_height(), size.get_depth())
+        , m_file(std::move(file))
+        , m_voxels(static_cast<value_t*>(m_file.data()))
+        , m_ranges(size.get_width(), size.get_height(), size.get_depth())
+        , m_dirty(size.get_width(), size.get_height(), size.get_depth())
+      {
+        if(m_file.size() != m_layout.capacity() * sizeof(value_t))
+        { throw std::invalid_argument("Volume file does not match the volume"); }
+        build_ranges(util::thread_pool::global());
+      }
+
+      /* What a saved volume of this type and size must match. */
+      static volume_key get_key(region const &size, uint64_t const source_hash)
+      {
+        return { source_hash, size.get_width(), size.get_height(), size.get_depth(),
+                 sizeof(value_t), layout_t::tag };
+      }
+
+      /* Saves the voxels, in layout order, so that a volume of the
+       * same size can be mapped from the file later. */
+      bool save(std::string const &path, uint64_t const source_hash) const
+      {
+        return volume_file::write(path, get_key(m_region, source_hash),
+                                  m_voxels, m_layout.capacity() * sizeof(value_t));
+      }
+
+      /* Writable access, here and below, can change voxels behind
+       * the ranges' back, so it stops them being trusted until the
+       * next touch(). Extraction is correct meanwhile, only slower. */
       value_t& at(size_t const x, size_t const y, size_t const z)
-      { return m_data.at(x).at(y).at(z); }
+      { check_bounds(x, y, z); return (*this)(x, y, z); }
       value_t const& at(size_t const x, size_t const y, size_t const z) const
-      { return m_data.at(x).at(y).at(z); }
+      { check_bounds(x, y, z); return (*this)(x, y, z); }
 
-      container_index_t& operator [](size_t const index)
-      { return m_data[index]; }
-      container_index_t const& operator [](size_t const index) const
-      { return m_data[index]; }
+      /* Unchecked access; this is what the extractors use. */
+      value_t& operator ()(size_t const x, size_t const y, size_t const z)
+      {
+        invalidate_ranges();
+        return m_voxels[m_layout.index(x, y, z)];
+      }
+      value_t const& operator ()(size_t const x, size_t const y, size_t const z) const
+      { return m_voxels[m_layout.index(x, y, z)]; }
+
+      /* Writes which keep the min/max ranges up to date and mark
+       * the voxel dirty. After writes through any other accessor,
+       * touch() what was written to have the ranges trusted again,
+       * and the mips and dirty boxes brought up to date. */
+      void set(size_t const x, size_t const y, size_t const z, value_t const value)
+      {
+        m_voxels[m_layout.index(x, y, z)] = value;
+        m_ranges.widen(x, y, z, value);
+        m_dirty.mark(x, y, z);
+        update_mips({ { static_cast<region::value_t>(x), static_cast<region::value_t>(y),
+                        static_cast<region::value_t>(z) },
+                      { static_cast<region::value_t>(x + 1), static_cast<region::value_t>(y + 1),
+                        static_cast<region::value_t>(z + 1) } });
+      }
+      void touch(region const &voxels)
+      {
+        m_ranges.rebuild(*this, voxels);
+        m_ranges_valid = true;
+        m_dirty.mark(voxels);
+        update_mips(voxels);
+      }
+
+      /* Hands each run of voxels to gen(run, a, b), to be written,
+       * where run is run(a, b); generators.h has some generators.
+       * The runs sharing an a are generated together, claimed by
+       * the pool's workers as they free up. The whole volume is dirty afterward. */
+      template <typename Generator>
+      void generate(Generator const &gen, util::thread_pool &pool)
+      {
+        generate_runs(gen, pool);
+        build_ranges(pool);
+        m_dirty.mark(m_region);
+        if(!m_mips.empty())
+        { build_mips(m_mips.size(), pool); }
+      }
+
+      /* Builds up to levels coarser copies of the volume, each half
+       * the last along every axis, rounded up. Voxel (x, y, z) of
+       * level l sits on voxel (x << l, y << l, z << l) of this one;
+       * see downsample.h for how it's filtered. Writes through set()
+       * and touch() carry down the chain. */
+      void build_mips(size_t const levels, util::thread_pool &pool)
+      {
+        m_mips.clear();
+        fixed_volume const *fine{ this };
+        for(size_t l{}; l < levels; ++l)
+        {
+          auto const &reg(fine->get_region());
+          if(reg.get_width() <= 1 && reg.get_height() <= 1 && reg.get_depth() <= 1)
+          { break; }
+
+          m_mips.emplace_back(new fixed_volume({ (reg.get_width() + 1) / 2,
+                                                 (reg.get_height() + 1) / 2,
+                                                 (reg.get_depth() + 1) / 2 }));
+          auto &coarse(*m_mips.back());
+          auto const &half(coarse.get_region());
+
+          std::vector<std::future<void>> futs;
+          futs.reserve(half.get_width());
+          for(region::value_t x{}; x < half.get_width(); ++x)
+          {
+            futs.push_back(pool.submit([fine, &coarse, &half, x]
+            {
+              downsample_into(*fine, coarse,
+              { { x, 0, 0 }, { x + 1, half.get_height(), half.get_depth() } });
+            }));
+          }
+          for(auto &f : futs)
+          { f.get(); }
+
+          coarse.build_ranges(pool);
+          fine = &coarse;
+        }
+      }
+
+      /* Level 0 is this volume. */
+      size_t get_mip_count() const
+      { return m_mips.size() + 1; }
+      fixed_volume const& get_mip(size_t const level) const
+      { return level ? *m_mips[level - 1] : *this; }
+
+      /* The boxes written since the last call. */
+      std::vector<region> take_dirty()
+      { return m_dirty.take(); }
+
+      /* Block granular; see range_query.h. Nothing is vouched for
+       * while the ranges may be stale. */
+      bool get_range(region const &voxels, value_t &min, value_t &max) const
+      { return m_ranges_valid.load() && m_ranges.get_range(voxels, min, max); }
+
+      container_index_t operator [](size_t const index)
+      {
+        invalidate_ranges();
+        return { *this, index };
+      }
+      const_container_index_t operator [](size_t const index) const
+      { return { *this, index }; }
+
+      /* Raw storage, in layout order. */
+      span<value_t> data()
+      {
+        invalidate_ranges();
+        return { m_voxels, m_layout.capacity() };
+      }
+      span<value_t const> data() const
+      { return { m_voxels, m_layout.capacity() }; }
+
+      /* The contiguous run along the layout's fastest axis;
+       * for layout::xyz, run(x, y) is the z column at (x, y). */
+      span<value_t> run(size_t const a, size_t const b)
+      {
+        static_assert(layout_t::linear, "Only linear layouts have runs");
+        invalidate_ranges();
+        return { m_voxels + m_layout.run_index(a, b), m_layout.run_length() };
+      }
+      span<value_t const> run(size_t const a, size_t const b) const
+      {
+        static_assert(layout_t::linear, "Only linear layouts have runs");
+        return { m_voxels + m_layout.run_index(a, b), m_layout.run_length() };
+      }
+
+      layout_t const& get_layout() const
+      { return m_layout; }
 
       region const& get_region() const
       { return m_region; }
 
     private:
-      void fill(fill_func_t const &func)
+      /* Refilters every coarse voxel reading any of the voxels,
+       * level by level. */
+      void update_mips(region const &voxels)
       {
-        log_info("filling volume");
-        log_push();
-
-        auto const size(m_region.get_width());
-        m_data.resize(size);
+        if(m_mips.empty())
+        { return; }
 
-        std::mutex loaded_mutex;
-        size_t loaded{};
-        auto const report([&](size_t const chunk)
+        vec3<region::value_t> lower(voxels.lower_corner), upper(voxels.upper_corner);
+        fixed_volume const *fine{ this };
+        for(auto &mip : m_mips)
         {
-          std::lock_guard<std::mutex> guard(loaded_mutex);
-          loaded += chunk;
-          log_debug("loaded %%%", (loaded * 100.0f / size));
-        });
+          /* Coarse voxel c reads fine voxels 2c - 1 through 2c + 1. */
+          auto const &half(mip->get_region());
+          lower = { std::max(lower.x, 0) / 2, std::max(lower.y, 0) / 2,
+                    std::max(lower.z, 0) / 2 };
+          upper = { std::min(upper.x / 2 + 1, half.get_width()),
+                    std::min(upper.y / 2 + 1, half.get_height()),
+                    std::min(upper.z / 2 + 1, half.get_depth()) };
+          if(lower.x >= upper.x || lower.y >= upper.y || lower.z >= upper.z)
+          { return; }
 
-        auto const width(size / m_max_threads);
-        std::vector<std::future<void>> futs;
-        futs.reserve(m_max_threads);
-        for(size_t i{}; i < m_max_threads; ++i)
-        {
-          futs.push_back(std::async(std::launch::async,
-                         std::bind(&fixed_volume<value_t>::fill_region, this,
-                         func, i * width, (i * width) + width, report)));
-        } futs.clear();
+          region const changed{ lower, upper };
+          downsample_into(*fine, *mip, changed);
+          mip->m_ranges.rebuild(*mip, changed);
+          mip->m_ranges_valid = true;
+          fine = mip.get();
+        }
+      }
 
-        log_pop();
-        log_info("volume filled");
+      /* Fills the voxels of coarse from those of fine, its last level. */
+      static void downsample_into(fixed_volume const &fine, fixed_volume &coarse,
+                                  region const &voxels)
+      {
+        downsample_into(fine, coarse, voxels,
+                        std::integral_constant<bool, std::is_same<value_t, uint8_t>::value &&
+                                                     std::is_same<layout_t, layout::xyz>::value>{});
       }
 
-      void fill_region(fill_func_t const &func,
-                       size_t const start_x, size_t const end_x,
-                       std::function<void (size_t const)> const &report)
+      /* Whole z runs at a time, through the vectorized kernels. */
+      static void downsample_into(fixed_volume const &fine, fixed_volume &coarse,
+                                  region const &voxels, std::true_type const)
       {
-        if(start_x == end_x)
-        { return; }
+        auto const &reg(fine.get_region());
+        size_t const length(reg.get_depth());
+        auto const clamp([](region::value_t const p, region::value_t const size)
+        { return static_cast<size_t>(std::min(std::max(p, 0), size - 1)); });
 
-        auto const width(end_x - start_x);
-        auto const region_height(m_region.get_height());
-        auto const region_depth(m_region.get_depth());
-        for(size_t x{ start_x }; x < width + start_x; ++x)
+        std::vector<uint16_t> sums(length);
+        size_t const first(voxels.lower_corner.z), last(voxels.upper_corner.z);
+        size_t const from{ first ? 2 * first - 1 : 0 }, to{ std::min(length, 2 * last) };
+        for(auto x(voxels.lower_corner.x); x < voxels.upper_corner.x; ++x)
         {
-          m_data[x].resize(region_height);
-          for(size_t y{}; y < region_height; ++y)
-          { m_data[x][y].resize(region_depth); }
+          for(auto y(voxels.lower_corner.y); y < voxels.upper_corner.y; ++y)
+          {
+            uint8_t const *rows[9];
+            for(region::value_t dx{}; dx < 3; ++dx)
+            {
+              for(region::value_t dy{}; dy < 3; ++dy)
+              {
+                rows[dx * 3 + dy] = fine.run(clamp(2 * x + dx - 1, reg.get_width()),
+                                             clamp(2 * y + dy - 1, reg.get_height())).data() + from;
+              }
+            }
+            downsample::gather(rows, to - from, sums.data() + from);
+            downsample::reduce(sums.data(), length, first, last, coarse.run(x, y).data());
+          }
         }
+      }
 
-        static constexpr const size_t report_rate{ 64 };
-        auto curr_x(start_x);
-        while(curr_x != end_x)
+      /* Any value type or layout, a voxel at a time. */
+      static void downsample_into(fixed_volume const &fine, fixed_volume &coarse,
+                                  region const &voxels, std::false_type const)
+      {
+        auto const &reg(fine.get_region());
+        auto const clamp([](region::value_t const p, region::value_t const size)
+        { return static_cast<size_t>(std::min(std::max(p, 0), size - 1)); });
+        int const weights[3]{ 1, 2, 1 };
+
+        for(auto x(voxels.lower_corner.x); x < voxels.upper_corner.x; ++x)
         {
-          auto const span_x(std::min(end_x - curr_x, report_rate));;
-          func(*this, curr_x, curr_x + span_x);
-          curr_x += span_x;
-          report(span_x);
+          for(auto y(voxels.lower_corner.y); y < voxels.upper_corner.y; ++y)
+          {
+            for(auto z(voxels.lower_corner.z); z < voxels.upper_corner.z; ++z)
+            {
+              double sum{};
+              for(region::value_t dx{}; dx < 3; ++dx)
+              {
+                for(region::value_t dy{}; dy < 3; ++dy)
+                {
+                  for(region::value_t dz{}; dz < 3; ++dz)
+                  {
+                    sum += weights[dx] * weights[dy] * weights[dz] *
+                           static_cast<double>(fine(clamp(2 * x + dx - 1, reg.get_width()),
+                                                    clamp(2 * y + dy - 1, reg.get_height()),
+                                                    clamp(2 * z + dz - 1, reg.get_depth())));
+                  }
+                }
+              }
+              double const mean{ sum / 64.0 };
+              coarse(x, y, z) = static_cast<value_t>(std::is_integral<value_t>::value ?
+                                                     std::floor(mean + 0.5) : mean);
+            }
+          }
         }
       }
 
-      container_t m_data;
+      template <typename Generator>
+      void generate_runs(Generator const &gen, util::thread_pool &pool)
+      {
+        static_assert(layout_t::linear, "Only linear layouts have runs");
+
+        pool.parallel_for(m_layout.run_rows(), 1,
+        [this, &gen](size_t const begin, size_t const end)
+        {
+          for(size_t a{ begin }; a < end; ++a)
+          {
+            for(size_t b{}; b < m_layout.run_columns(); ++b)
+            { gen(run(a, b), a, b); }
+          }
+        });
+      }
+
+      void build_ranges(util::thread_pool &pool)
+      {
+        m_ranges.build(*this, pool);
+        m_ranges_valid = true;
+      }
+
+      /* Only stored when it changes; writers on every thread hit
+       * this, and they shouldn't fight over the line. */
+      void invalidate_ranges()
+      {
+        if(m_ranges_valid.load(std::memory_order_relaxed))
+        { m_ranges_valid.store(false, std::memory_order_relaxed); }
+      }
+
+      void check_bounds(size_t const x, size_t const y, size_t const z) const
+      {
+        if(x >= static_cast<size_t>(m_region.get_width()) ||
+           y >= static_cast<size_t>(m_region.get_height()) ||
+           z >= static_cast<size_t>(m_region.get_depth()))
+        { throw std::out_of_range("Voxel index out of volume bounds"); }
+      }
+
+      /* Columns of x are handed out a few at a time, so uneven
+       * generators still keep every worker busy. */
+      void fill(fill_func_t const &func)
+      {
+        log_info("filling volume");
+        log_push();
+
+        auto const size(m_region.get_width());
+        m_data.resize(m_layout.capacity());
+        m_voxels = m_data.data();
+
+        static constexpr const size_t report_rate{ 10 };
+        std::atomic<size_t> loaded{ 0 };
+        auto &pool(util::thread_pool::global());
+        pool.parallel_for(size, fill_grain,
+        [&](size_t const start_x, size_t const end_x)
+        {
+          func(*this, start_x, end_x);
+
+          /* Only whoever crosses each step reports it. */
+          size_t const span_x(end_x - start_x);
+          size_t const before(loaded.fetch_add(span_x));
+          if((before * report_rate) / size != ((before + span_x) * report_rate) / size)
+          { log_debug("loaded %%%", ((before + span_x) * 100.0f / size)); }
+        });
+
+        log_info("building ranges");
+        build_ranges(pool);
+
+        log_pop();
+        log_info("volume filled");
+      }
+
       region const m_region;
-      static constexpr const size_t m_max_threads{ 8 };
+      layout_t const m_layout;
+      container_t m_data;
+      volume_file m_file;
+      value_t *m_voxels{};
+      range_pyramid<value_t> m_ranges;
+      std::atomic<bool> m_ranges_valid{ true };
+      dirty_tracker<> m_dirty;
+      std::vector<std::unique_ptr<fixed_volume>> m_mips;
+      static constexpr const size_t fill_grain{ 4 };
   };
 }
@@ -0,0 +1,82 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/generators.cpp
+  Author: Jesse 'Jeaye' Wilkerson
+*/
+
+#include "generators.h"
+
+/* SSE2 is always there on x86-64. */
+#if defined(__x86_64__) && defined(__GNUC__)
+  #define VOX_GENERATORS_SSE2
+  #include <emmintrin.h>
+#endif
+
+namespace vox
+{
+  namespace generators
+  {
+    void threshold(float const *heights, size_t const count, float const level,
+                   uint8_t const solid, uint8_t const empty, uint8_t *out)
+    {
+      size_t i{};
+#ifdef VOX_GENERATORS_SSE2
+      __m128 const y(_mm_set1_ps(level));
+      __m128i const solids(_mm_set1_epi8(static_cast<char>(solid)));
+      __m128i const empties(_mm_set1_epi8(static_cast<char>(empty)));
+      for(; i + 16 <= count; i += 16)
+      {
+        /* All ones or all zeroes per lane, which packing keeps. */
+        auto const below([&](size_t const k)
+        { return _mm_castps_si128(_mm_cmple_ps(y, _mm_loadu_ps(heights + i + k))); });
+        __m128i const mask(_mm_packs_epi16(_mm_packs_epi32(below(0), below(4)),
+                                           _mm_packs_epi32(below(8), below(12))));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                         _mm_or_si128(_mm_and_si128(mask, solids),
+                                      _mm_andnot_si128(mask, empties)));
+      }
+#endif
+      threshold<uint8_t>(heights + i, count - i, level, solid, empty, out + i);
+    }
+
+    void blend(float const from, float const to, float const *weights,
+               size_t const count, float const amplitude, float *acc)
+    {
+      float const base{ amplitude * from }, slope{ amplitude * (to - from) };
+      size_t i{};
+#ifdef VOX_GENERATORS_SSE2
+      __m128 const bases(_mm_set1_ps(base)), slopes(_mm_set1_ps(slope));
+      for(; i + 4 <= count; i += 4)
+      {
+        __m128 const w(_mm_loadu_ps(weights + i));
+        _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i),
+                                          _mm_add_ps(bases, _mm_mul_ps(slopes, w))));
+      }
+#endif
+      for(; i < count; ++i)
+      { acc[i] += base + slope * weights[i]; }
+    }
+
+    void quantize(float const *values, size_t const count, float const low,
+                  float const high, uint8_t *out)
+    {
+      size_t i{};
+#ifdef VOX_GENERATORS_SSE2
+      /* Rounds to nearest; the packs saturate, which clamps. */
+      __m128 const lows(_mm_set1_ps(low)), scale(_mm_set1_ps(high - low));
+      for(; i + 16 <= count; i += 16)
+      {
+        auto const convert([&](size_t const k)
+        { return _mm_cvtps_epi32(_mm_add_ps(lows, _mm_mul_ps(scale, _mm_loadu_ps(values + i + k)))); });
+        __m128i const words(_mm_packs_epi32(convert(0), convert(4)));
+        __m128i const more(_mm_packs_epi32(convert(8), convert(12)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(words, more));
+      }
+#endif
+      quantize<uint8_t>(values + i, count - i, low, high, out + i);
+    }
+  }
+}
@@ -0,0 +1,226 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/generators.h
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    Generators for fixed_volume::generate(), which hands
+    them whole runs of voxels at a time. These expect the
+    runs of layout::xyz: gen(run, x, y) writes the z
+    column at (x, y). The uint8_t paths are vectorized.
+*/
+
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <type_traits>
+
+#include "span.h"
+
+namespace vox
+{
+  namespace generators
+  {
+    /* out[i] = level <= heights[i] ? solid : empty */
+    void threshold(float const *heights, size_t const count, float const level,
+                   uint8_t const solid, uint8_t const empty, uint8_t *out);
+    template <typename Value>
+    void threshold(float const *heights, size_t const count, float const level,
+                   Value const solid, Value const empty, Value *out)
+    {
+      for(size_t i{}; i < count; ++i)
+      { out[i] = level <= heights[i] ? solid : empty; }
+    }
+
+    /* acc[i] += amplitude * (from + (to - from) * weights[i]) */
+    void blend(float const from, float const to, float const *weights,
+               size_t const count, float const amplitude, float *acc);
+
+    /* out[i] = low + (high - low) * values[i], rounded and clamped
+     * to the value type. */
+    void quantize(float const *values, size_t const count, float const low,
+                  float const high, uint8_t *out);
+    template <typename Value>
+    void quantize(float const *values, size_t const count, float const low,
+                  float const high, Value *out)
+    {
+      for(size_t i{}; i < count; ++i)
+      {
+        float v{ low + (high - low) * values[i] };
+        if(std::is_integral<Value>::value)
+        {
+          v = std::min(std::max(std::floor(v + 0.5f),
+                                static_cast<float>(std::numeric_limits<Value>::lowest())),
+                       static_cast<float>(std::numeric_limits<Value>::max()));
+        }
+        out[i] = static_cast<Value>(v);
+      }
+    }
+  }
+
+  /* Every voxel takes the same value. */
+  template <typename Value>
+  class constant_generator
+  {
+    public:
+      using value_t = Value;
+
+      explicit constant_generator(value_t const value)
+        : m_value(value)
+      { }
+
+      void operator ()(span<value_t> const &run, size_t const, size_t const) const
+      { std::fill(run.begin(), run.end(), m_value); }
+
+    private:
+      value_t const m_value;
+  };
+
+  /* Solid up to each column's height and empty above, as in
+   * heightfield_volume; Heights provides get_heights(x), the
+   * heights along z at x, and get_solid() and get_empty(). */
+  template <typename Heights>
+  class heightfield_generator
+  {
+    public:
+      using value_t = typename Heights::value_t;
+
+      explicit heightfield_generator(Heights const &heights)
+        : m_heights(heights)
+      { }
+
+      void operator ()(span<value_t> const &run, size_t const x, size_t const y) const
+      {
+        auto const heights(m_heights.get_heights(x));
+        generators::threshold(heights.data(), std::min(run.size(), heights.size()),
+                              static_cast<float>(y), m_heights.get_solid(),
+                              m_heights.get_empty(), run.data());
+      }
+
+    private:
+      Heights const &m_heights;
+  };
+
+  /* Fractal value noise, mapped onto [low, high]. The first octave's
+   * lattice points are period voxels apart, a power of two; each
+   * octave after halves that and the amplitude. Lattice values are
+   * hashed from the seed, so any run can be generated on its own. */
+  template <typename Value>
+  class noise_generator
+  {
+    public:
+      using value_t = Value;
+
+      noise_generator(size_t const period, size_t const octaves, uint32_t const seed,
+                      value_t const low, value_t const high)
+        : m_seed(seed)
+        , m_low(static_cast<float>(low))
+        , m_high(static_cast<float>(high))
+      {
+        size_t shift{};
+        while((size_t{ 2 } << shift) <= period)
+        { ++shift; }
+
+        float total{};
+        for(size_t o{}; o < octaves && o <= shift; ++o)
+        {
+          octave oct;
+          oct.shift = shift - o;
+          oct.amplitude = 1.0f / (1 << o);
+          size_t const length{ size_t{ 1 } << oct.shift };
+          oct.weights.resize(length);
+          for(size_t i{}; i < length; ++i)
+          {
+            float const t{ static_cast<float>(i) / length };
+            oct.weights[i] = t * t * (3.0f - 2.0f * t);
+          }
+          total += oct.amplitude;
+          m_octaves.push_back(std::move(oct));
+        }
+        for(auto &oct : m_octaves)
+        { oct.amplitude /= total; }
+      }
+
+      void operator ()(span<value_t> const &run, size_t const x, size_t const y) const
+      {
+        float acc[block_size];
+        for(size_t begin{}; begin < run.size(); begin += block_size)
+        {
+          size_t const left{ run.size() - begin };
+          size_t const count{ std::min(left, size_t{ block_size }) };
+          std::fill(acc, acc + count, 0.0f);
+          for(size_t o{}; o < m_octaves.size(); ++o)
+          { add_octave(o, x, y, begin, count, acc); }
+          generators::quantize(acc, count, m_low, m_high, run.data() + begin);
+        }
+      }
+
+    private:
+      struct octave
+      {
+        size_t shift;
+        float amplitude;
+        /* Smoothed offsets into a lattice cell. */
+        std::vector<float> weights;
+      };
+
+      /* Lattice values are bilinear across x and y, so each run only
+       * blends between consecutive lattice points along z. */
+      void add_octave(size_t const o, size_t const x, size_t const y,
+                      size_t const begin, size_t const count, float * const acc) const
+      {
+        auto const &oct(m_octaves[o]);
+        size_t const mask{ (size_t{ 1 } << oct.shift) - 1 };
+        uint32_t const seed{ m_seed + static_cast<uint32_t>(o) * 0x9e3779b9u };
+        size_t const i{ x >> oct.shift }, j{ y >> oct.shift };
+        float const fx{ oct.weights[x & mask] }, fy{ oct.weights[y & mask] };
+        auto const lattice([&](size_t const k)
+        {
+          float const v00{ hash(seed, i, j, k) }, v10{ hash(seed, i + 1, j, k) };
+          float const v01{ hash(seed, i, j + 1, k) }, v11{ hash(seed, i + 1, j + 1, k) };
+          float const v0{ v00 + fx * (v10 - v00) }, v1{ v01 + fx * (v11 - v01) };
+          return v0 + fy * (v1 - v0);
+        });
+
+        size_t z{ begin };
+        size_t const end{ begin + count };
+        float lower{ lattice(z >> oct.shift) };
+        while(z < end)
+        {
+          size_t const k{ z >> oct.shift };
+          size_t const stop{ std::min(end, (k + 1) << oct.shift) };
+          float const upper{ lattice(k + 1) };
+          generators::blend(lower, upper, oct.weights.data() + (z & mask), stop - z,
+                            oct.amplitude, acc + (z - begin));
+          lower = upper;
+          z = stop;
+        }
+      }
+
+      /* In [0, 1). */
+      static float hash(uint32_t const seed, size_t const i, size_t const j, size_t const k)
+      {
+        uint32_t h{ seed };
+        h ^= static_cast<uint32_t>(i) * 0x8da6b343u;
+        h ^= static_cast<uint32_t>(j) * 0xd8163841u;
+        h ^= static_cast<uint32_t>(k) * 0xcb1ab31fu;
+        h = (h ^ (h >> 16)) * 0x7feb352du;
+        h = (h ^ (h >> 15)) * 0x846ca68bu;
+        h ^= h >> 16;
+        return static_cast<float>(h >> 8) / static_cast<float>(1 << 24);
+      }
+
+      static size_t constexpr const block_size{ 256 };
+
+      uint32_t const m_seed;
+      float const m_low, m_high;
+      std::vector<octave> m_octaves;
+  };
+}
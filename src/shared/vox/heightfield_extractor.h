@@ -0,0 +1,153 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/heightfield_extractor.h
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    Meshes a heightfield as a grid of columns. Every
+    column crosses the surface exactly once, so there is
+    nothing to classify: each lattice point is a vertex
+    at its column's height and each cell is two triangles.
+    Use surface_extractor for anything with overhangs.
+*/
+
+#pragma once
+
+#include <vector>
+#include <cassert>
+#include <algorithm>
+
+#include "region.h"
+#include "surface.h"
+#include "indexed_surface.h"
+
+namespace vox
+{
+  /* Heightfield needs get_region() and get_height(x, z); see
+   * heightfield_volume.h. */
+  template <typename Triangle, typename Heightfield>
+  class heightfield_extractor
+  {
+    public:
+      using surface_t = surface<Triangle>;
+      using indexed_surface_t = indexed_surface<typename Triangle::vertex_t>;
+
+      /* Columns are sampled every unit voxels along x and z, over the
+       * same lattice surface_extractor would use for the region. Heights
+       * are clamped to the region's y range. */
+      heightfield_extractor(Heightfield const &field, region const &reg, size_t const unit)
+        : m_field(field)
+        , m_region(reg)
+        , m_unit_size(unit)
+      { assert(m_field.get_region().contains(m_region)); }
+
+      heightfield_extractor& operator =(heightfield_extractor const &) = delete;
+
+      region const& get_region() const
+      { return m_region; }
+
+      surface_t operator ()() const
+      {
+        surface_t surface(m_region);
+        (*this)(surface);
+        return surface;
+      }
+
+      void operator ()(surface_t &surface) const
+      {
+        surface.clear();
+        surface.reserve(get_cells_x() * get_cells_z() * 2);
+        auto sink([&surface](Triangle const &tri){ surface.add_triangle(tri); });
+        extract(sink);
+      }
+
+      /* Hands every triangle, in order, to sink(Triangle const&).
+       * Each cell is split along its (x + 1, z) to (x, z + 1) diagonal;
+       * triangles face up, away from the solid side. */
+      template <typename Sink>
+      void extract(Sink &sink) const
+      {
+        size_t const cells_x{ get_cells_x() }, cells_z{ get_cells_z() };
+        if(!cells_x || !cells_z)
+        { return; }
+
+        /* Two rows of points along z. */
+        std::vector<vec3<float>> row(cells_z + 1), next_row(cells_z + 1);
+        load_row(row, 0);
+        for(size_t i{}; i < cells_x; ++i)
+        {
+          load_row(next_row, i + 1);
+          for(size_t k{}; k < cells_z; ++k)
+          {
+            sink(Triangle(row[k], row[k + 1], next_row[k]));
+            sink(Triangle(next_row[k], row[k + 1], next_row[k + 1]));
+          }
+          std::swap(row, next_row);
+        }
+      }
+
+      /* One vertex per lattice point. */
+      indexed_surface_t extract_indexed() const
+      {
+        using index_t = typename indexed_surface_t::index_t;
+
+        indexed_surface_t surface(m_region);
+        size_t const cells_x{ get_cells_x() }, cells_z{ get_cells_z() };
+        if(!cells_x || !cells_z)
+        { return surface; }
+
+        std::vector<vec3<float>> row(cells_z + 1);
+        for(size_t i{}; i <= cells_x; ++i)
+        {
+          load_row(row, i);
+          for(auto const &p : row)
+          { surface.add_vertex(p); }
+        }
+
+        size_t const points_z{ cells_z + 1 };
+        for(size_t i{}; i < cells_x; ++i)
+        {
+          for(size_t k{}; k < cells_z; ++k)
+          {
+            auto const p00(static_cast<index_t>(i * points_z + k));
+            auto const p10(static_cast<index_t>(p00 + points_z));
+            surface.add_triangle(p00, p00 + 1, p10);
+            surface.add_triangle(p10, p00 + 1, p10 + 1);
+          }
+        }
+        return surface;
+      }
+
+    private:
+      /* As surface_extractor: cell origins lie in [lower, upper - unit). */
+      size_t get_cells(region::value_t const lower, region::value_t const upper) const
+      {
+        auto const span(upper - static_cast<region::value_t>(m_unit_size) - lower);
+        return span > 0 ? (static_cast<size_t>(span) + m_unit_size - 1) / m_unit_size : 0;
+      }
+      size_t get_cells_x() const
+      { return get_cells(m_region.lower_corner.x, m_region.upper_corner.x); }
+      size_t get_cells_z() const
+      { return get_cells(m_region.lower_corner.z, m_region.upper_corner.z); }
+
+      /* The points of the i'th row along x. */
+      void load_row(std::vector<vec3<float>> &row, size_t const i) const
+      {
+        auto const bottom(static_cast<float>(m_region.lower_corner.y));
+        auto const top(static_cast<float>(m_region.upper_corner.y - 1));
+        size_t const x{ m_region.lower_corner.x + i * m_unit_size };
+        for(size_t k{}; k < row.size(); ++k)
+        {
+          size_t const z{ m_region.lower_corner.z + k * m_unit_size };
+          float const height{ std::min(top, std::max(bottom, m_field.get_height(x, z))) };
+          row[k] = { static_cast<float>(x), height, static_cast<float>(z) };
+        }
+      }
+
+      Heightfield const &m_field;
+      region const m_region;
+      size_t const m_unit_size;
+  };
+}
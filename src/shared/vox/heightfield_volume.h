@@ -0,0 +1,218 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/heightfield_volume.h
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    A volume which is solid from the bottom of each
+    column up to that column's height, and empty above.
+    Only the heights are stored; voxels are synthesized
+    whenever they're read.
+*/
+
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <future>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+#include "region.h"
+#include "span.h"
+#include "dirty_tracker.h"
+#include "util/thread_pool.h"
+#include "log/logger.h"
+
+namespace vox
+{
+  template <typename Value, size_t TileSize = 8>
+  class heightfield_volume
+  {
+    static_assert(TileSize && !(TileSize & (TileSize - 1)),
+                  "Tile size must be a power of two");
+
+    public:
+      using value_t = Value;
+      /* The height of the column at (x, z), in voxels; the voxel at
+       * y is solid when y <= height. */
+      using height_func_t = std::function<float (size_t const, size_t const)>;
+      static size_t constexpr const tile_size{ TileSize };
+
+      heightfield_volume(region const &size,
+                         value_t const solid = std::numeric_limits<value_t>::max(),
+                         value_t const empty = value_t{})
+        : m_region(size)
+        , m_solid(solid)
+        , m_empty(empty)
+        , m_tiles_z(tiles_along(size.get_depth()))
+        , m_heights(size.get_width() * size.get_depth(), -1.0f)
+        , m_tiles(tiles_along(size.get_width()) * m_tiles_z, tile{ -1.0f, -1.0f })
+        , m_dirty(size.get_width(), size.get_height(), size.get_depth())
+      { }
+
+      heightfield_volume(region const &size, height_func_t const &func,
+                         value_t const solid = std::numeric_limits<value_t>::max(),
+                         value_t const empty = value_t{})
+        : heightfield_volume(size, solid, empty)
+      { fill(func); }
+
+      value_t at(size_t const x, size_t const y, size_t const z) const
+      {
+        if(x >= static_cast<size_t>(m_region.get_width()) ||
+           y >= static_cast<size_t>(m_region.get_height()) ||
+           z >= static_cast<size_t>(m_region.get_depth()))
+        { throw std::out_of_range("Voxel index out of volume bounds"); }
+        return (*this)(x, y, z);
+      }
+
+      /* Unchecked access; this is what the extractors use. */
+      value_t operator ()(size_t const x, size_t const y, size_t const z) const
+      { return (y <= get_height(x, z)) ? m_solid : m_empty; }
+
+      float get_height(size_t const x, size_t const z) const
+      { return m_heights[x * m_region.get_depth() + z]; }
+      /* The heights of every column at x, along z. */
+      span<float const> get_heights(size_t const x) const
+      {
+        size_t const depth(m_region.get_depth());
+        return { m_heights.data() + x * depth, depth };
+      }
+
+      value_t get_solid() const
+      { return m_solid; }
+      value_t get_empty() const
+      { return m_empty; }
+
+      /* Moves a column's surface; the voxels between its old and
+       * new heights are marked dirty. */
+      void set_height(size_t const x, size_t const z, float const height)
+      {
+        auto &h(m_heights[x * m_region.get_depth() + z]);
+        if(h == height)
+        { return; }
+
+        auto const lower(std::min(h, height)), upper(std::max(h, height));
+        h = height;
+        settle(x / tile_size, z / tile_size);
+
+        /* Voxels with lower < y <= upper flip. */
+        auto const top(static_cast<region::value_t>(m_region.get_height()));
+        auto const from(std::min(top, static_cast<region::value_t>(std::max(0.0f, std::floor(lower) + 1.0f))));
+        auto const to(std::min(top, static_cast<region::value_t>(std::max(0.0f, std::floor(upper) + 1.0f))));
+        auto const cx(static_cast<region::value_t>(x)), cz(static_cast<region::value_t>(z));
+        m_dirty.mark({ { cx, from, cz }, { cx + 1, to, cz + 1 } });
+      }
+
+      /* The boxes written since the last call. */
+      std::vector<region> take_dirty()
+      { return m_dirty.take(); }
+
+      /* Tile granular in x and z, exact in y; see range_query.h. */
+      bool get_range(region const &voxels, value_t &min, value_t &max) const
+      {
+        size_t const lower_x(std::max(voxels.lower_corner.x, 0) / tile_size);
+        size_t const lower_z(std::max(voxels.lower_corner.z, 0) / tile_size);
+        size_t const upper_x(std::min(tiles_along(std::max(voxels.upper_corner.x, 0)),
+                                      tiles_along(m_region.get_width())));
+        size_t const upper_z(std::min(tiles_along(std::max(voxels.upper_corner.z, 0)), m_tiles_z));
+        if(lower_x >= upper_x || lower_z >= upper_z ||
+           voxels.upper_corner.y <= voxels.lower_corner.y)
+        { return false; }
+
+        tile range(m_tiles[lower_x * m_tiles_z + lower_z]);
+        for(size_t tx{ lower_x }; tx < upper_x; ++tx)
+        {
+          for(size_t tz{ lower_z }; tz < upper_z; ++tz)
+          {
+            auto const &t(m_tiles[tx * m_tiles_z + tz]);
+            range.low = std::min(range.low, t.low);
+            range.high = std::max(range.high, t.high);
+          }
+        }
+
+        /* The box holds some solid voxel unless every column ends
+         * below its bottom, and some empty one unless every column
+         * reaches past its top. */
+        auto const bottom(static_cast<float>(voxels.lower_corner.y));
+        auto const top(static_cast<float>(voxels.upper_corner.y - 1));
+        bool const solid{ bottom <= range.high };
+        bool const empty{ top > range.low };
+        min = max = solid ? m_solid : m_empty;
+        if(solid && empty)
+        {
+          min = std::min(m_solid, m_empty);
+          max = std::max(m_solid, m_empty);
+        }
+        return true;
+      }
+
+      region const& get_region() const
+      { return m_region; }
+
+    private:
+      struct tile
+      { float low, high; };
+
+      static size_t tiles_along(region::value_t const length)
+      { return length > 0 ? (length + tile_size - 1) / tile_size : 0; }
+
+      /* Recomputes a tile's lowest and highest column. */
+      void settle(size_t const tx, size_t const tz)
+      {
+        size_t const depth(m_region.get_depth());
+        size_t const upper_x{ std::min<size_t>((tx + 1) * tile_size, m_region.get_width()) };
+        size_t const upper_z{ std::min<size_t>((tz + 1) * tile_size, depth) };
+        auto &t(m_tiles[tx * m_tiles_z + tz]);
+        t.low = t.high = m_heights[(tx * tile_size) * depth + tz * tile_size];
+        for(size_t x{ tx * tile_size }; x < upper_x; ++x)
+        {
+          for(size_t z{ tz * tile_size }; z < upper_z; ++z)
+          {
+            t.low = std::min(t.low, m_heights[x * depth + z]);
+            t.high = std::max(t.high, m_heights[x * depth + z]);
+          }
+        }
+      }
+
+      /* One pass over the columns; each x-slab of tiles is a task. */
+      void fill(height_func_t const &func)
+      {
+        log_info("filling heightfield");
+        log_push();
+
+        size_t const width(m_region.get_width()), depth(m_region.get_depth());
+        auto &pool(util::thread_pool::global());
+        std::vector<std::future<void>> futs;
+        for(size_t tx{}; tx < tiles_along(m_region.get_width()); ++tx)
+        {
+          futs.push_back(pool.submit([this, &func, tx, width, depth]
+          {
+            for(size_t x{ tx * tile_size }; x < std::min((tx + 1) * tile_size, width); ++x)
+            {
+              for(size_t z{}; z < depth; ++z)
+              { m_heights[x * depth + z] = func(x, z); }
+            }
+            for(size_t tz{}; tz < m_tiles_z; ++tz)
+            { settle(tx, tz); }
+          }));
+        }
+        for(auto &f : futs)
+        { f.get(); }
+
+        log_pop();
+        log_info("heightfield filled");
+      }
+
+      region const m_region;
+      value_t const m_solid, m_empty;
+      size_t const m_tiles_z;
+      std::vector<float> m_heights;
+      std::vector<tile> m_tiles;
+      dirty_tracker<> m_dirty;
+  };
+}
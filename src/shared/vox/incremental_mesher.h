@@ -0,0 +1,408 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/incremental_mesher.h
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    Keeps a volume's surface as a grid of chunk meshes and
+    re-extracts only the chunks touched by dirty voxels.
+    Each chunk's cells read one lattice step past its upper
+    faces; that apron is what stitches neighbours together.
+    Given more than one level of detail, each chunk's lattice
+    coarsens with its distance from the eye and chunks are
+    meshed through a lod_field, so mixed levels still meet;
+    only the cells along a change of level are stitched,
+    the rest are plain cubes.
+    Chunks can be simplified once extracted; their faces are
+    left alone, so seams survive. Volumes with a mip chain
+    are read at the level matching each chunk's lattice.
+    Chunks are extracted in place, into the storage of the
+    surfaces they replace; each chunk's generation changes
+    as it does, so copies of it can be told apart.
+*/
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <future>
+#include <algorithm>
+#include <cmath>
+
+#include "region.h"
+#include "surface.h"
+#include "surface_extractor.h"
+#include "lod_field.h"
+#include "mip_view.h"
+#include "simplifier.h"
+#include "util/thread_pool.h"
+
+namespace vox
+{
+  template <typename Triangle, typename Volume>
+  class incremental_mesher
+  {
+    public:
+      using surface_t = surface<Triangle>;
+      using extractor_t = surface_extractor<Triangle, Volume>;
+      using value_t = typename Volume::value_t;
+
+      /* Level l samples every (unit << l) voxels; chunks are rounded
+       * up to fit a whole number of cells at the coarsest level. */
+      incremental_mesher(Volume const &vol, value_t const level,
+                         size_t const unit, size_t const chunk_voxels = 64,
+                         size_t const lod_levels = 1)
+        : m_volume(vol)
+        , m_iso_level(level)
+        , m_chunk_voxels(chunk_voxels)
+        , m_lod_levels(std::max<size_t>(1, lod_levels))
+      { set_unit_size(unit); }
+
+      incremental_mesher(incremental_mesher const &) = delete;
+      incremental_mesher& operator =(incremental_mesher const &) = delete;
+
+      /* Changes the lattice; every chunk needs to be rebuilt, and
+       * drops back to the finest level of detail. */
+      void set_unit_size(size_t const unit)
+      {
+        m_unit_size = unit;
+        size_t const coarsest{ unit << (m_lod_levels - 1) };
+        m_chunk_size = ((m_chunk_voxels + coarsest - 1) / coarsest) * coarsest;
+
+        auto const &reg(m_volume.get_region());
+        auto const chunks_along([this](region::value_t const length)
+        {
+          auto const cells(std::max<region::value_t>(0, length - static_cast<region::value_t>(m_unit_size)));
+          return (static_cast<size_t>(cells) + m_chunk_size - 1) / m_chunk_size;
+        });
+        m_chunks_x = chunks_along(reg.get_width());
+        m_chunks_y = chunks_along(reg.get_height());
+        m_chunks_z = chunks_along(reg.get_depth());
+
+        m_levels.assign(m_chunks_x * m_chunks_y * m_chunks_z, 0);
+        m_chunks.resize(m_levels.size());
+        for(size_t i{}; i < m_chunks.size(); ++i)
+        { reset_chunk(i); }
+      }
+
+      /* Picks each chunk's level from the distance between the eye
+       * and the nearest point of the chunk: level l is used out to
+       * (distance << l), past which the next level takes over.
+       * Returns the chunks to re-extract, without extracting them:
+       * those which changed level, and their neighbours, whose faces
+       * see different values along a seam with a new level. So do the
+       * chunks two along each axis; cells on a seam look at the cell
+       * across each face, which may be on a seam of its own at the
+       * far face of a chunk one cell thick. */
+      std::vector<size_t> select_lod(vec3<float> const &eye, float const distance)
+      {
+        std::vector<size_t> changed;
+        if(m_lod_levels == 1)
+        { return changed; }
+
+        std::vector<bool> marked(m_chunks.size());
+        auto const mark([&](size_t const index)
+        {
+          if(!marked[index])
+          {
+            marked[index] = true;
+            changed.push_back(index);
+          }
+        });
+        for(size_t cx{}; cx < m_chunks_x; ++cx)
+        {
+          for(size_t cy{}; cy < m_chunks_y; ++cy)
+          {
+            for(size_t cz{}; cz < m_chunks_z; ++cz)
+            {
+              auto const index(chunk_index(cx, cy, cz));
+              auto const level(choose_level(eye, distance, cx, cy, cz));
+              if(level == m_levels[index])
+              { continue; }
+
+              m_levels[index] = level;
+              reset_chunk(index);
+              for(size_t nx{ cx ? cx - 1 : 0 }; nx <= std::min(cx + 1, m_chunks_x - 1); ++nx)
+              {
+                for(size_t ny{ cy ? cy - 1 : 0 }; ny <= std::min(cy + 1, m_chunks_y - 1); ++ny)
+                {
+                  for(size_t nz{ cz ? cz - 1 : 0 }; nz <= std::min(cz + 1, m_chunks_z - 1); ++nz)
+                  { mark(chunk_index(nx, ny, nz)); }
+                }
+              }
+              if(cx >= 2)
+              { mark(chunk_index(cx - 2, cy, cz)); }
+              if(cx + 2 < m_chunks_x)
+              { mark(chunk_index(cx + 2, cy, cz)); }
+              if(cy >= 2)
+              { mark(chunk_index(cx, cy - 2, cz)); }
+              if(cy + 2 < m_chunks_y)
+              { mark(chunk_index(cx, cy + 2, cz)); }
+              if(cz >= 2)
+              { mark(chunk_index(cx, cy, cz - 2)); }
+              if(cz + 2 < m_chunks_z)
+              { mark(chunk_index(cx, cy, cz + 2)); }
+            }
+          }
+        }
+
+        std::sort(changed.begin(), changed.end());
+        return changed;
+      }
+
+      /* select_lod(), then re-extracts what it returned. */
+      std::vector<size_t> update_lod(vec3<float> const &eye, float const distance,
+                                     util::thread_pool &pool)
+      {
+        auto const changed(select_lod(eye, distance));
+        extract(changed, pool);
+        return changed;
+      }
+
+      /* Re-extracts every chunk. */
+      void rebuild(util::thread_pool &pool)
+      {
+        std::vector<size_t> all(m_chunks.size());
+        for(size_t i{}; i < all.size(); ++i)
+        { all[i] = i; }
+        extract(all, pool);
+      }
+
+      /* Re-extracts each chunk with a cell which reads any of the
+       * dirty voxels, and returns the indices of those chunks. Coarse
+       * mip voxels are filtered from the voxels around them, so a
+       * write reaches that much further. With levels of detail, cells
+       * on a seam also classify the cell across each face, which is
+       * up to a coarsest lattice step further again. */
+      std::vector<size_t> update(std::vector<region> const &dirty, util::thread_pool &pool)
+      {
+        size_t const coarsest_unit{ m_unit_size << (m_lod_levels - 1) };
+        auto const coarsest(mip_query<Volume>::level_for(m_volume, coarsest_unit));
+        auto const apron(static_cast<region::value_t>(((1 << coarsest) - 1) +
+                                                      (m_lod_levels > 1 ? coarsest_unit : 0)));
+
+        std::vector<bool> marked(m_chunks.size());
+        std::vector<size_t> changed;
+        for(auto const &voxels : dirty)
+        {
+          size_t lower_x, upper_x, lower_y, upper_y, lower_z, upper_z;
+          if(!chunks_reading(voxels.lower_corner.x - apron, voxels.upper_corner.x + apron,
+                             m_chunks_x, lower_x, upper_x) ||
+             !chunks_reading(voxels.lower_corner.y - apron, voxels.upper_corner.y + apron,
+                             m_chunks_y, lower_y, upper_y) ||
+             !chunks_reading(voxels.lower_corner.z - apron, voxels.upper_corner.z + apron,
+                             m_chunks_z, lower_z, upper_z))
+          { continue; }
+
+          for(size_t cx{ lower_x }; cx <= upper_x; ++cx)
+          {
+            for(size_t cy{ lower_y }; cy <= upper_y; ++cy)
+            {
+              for(size_t cz{ lower_z }; cz <= upper_z; ++cz)
+              {
+                auto const index(chunk_index(cx, cy, cz));
+                if(!marked[index])
+                {
+                  marked[index] = true;
+                  changed.push_back(index);
+                }
+              }
+            }
+          }
+        }
+
+        std::sort(changed.begin(), changed.end());
+        extract(changed, pool);
+        return changed;
+      }
+
+      size_t get_chunk_count() const
+      { return m_chunks.size(); }
+      /* Later extractions write into the chunk in place. */
+      surface_t const& get_chunk(size_t const index) const
+      { return *m_chunks[index].surface; }
+      /* Changes whenever the chunk does, and is never reused; no
+       * chunk's is 0. Compare it against a copy's to tell whether
+       * the copy is stale. */
+      size_t get_chunk_generation(size_t const index) const
+      { return m_chunks[index].generation; }
+      size_t get_chunk_level(size_t const index) const
+      { return m_levels[index]; }
+
+      /* The voxels read by a chunk's cells, apron included. */
+      region get_chunk_region(size_t const index) const
+      {
+        size_t const cz{ index % m_chunks_z };
+        size_t const cy{ (index / m_chunks_z) % m_chunks_y };
+        size_t const cx{ index / (m_chunks_z * m_chunks_y) };
+        auto const &reg(m_volume.get_region());
+        size_t const unit{ m_unit_size << m_levels[index] };
+        auto const bound([this, unit](size_t const c, region::value_t const length)
+        {
+          return std::min(static_cast<region::value_t>((c + 1) * m_chunk_size + unit),
+                          length);
+        });
+        return
+        {
+          { static_cast<region::value_t>(cx * m_chunk_size),
+            static_cast<region::value_t>(cy * m_chunk_size),
+            static_cast<region::value_t>(cz * m_chunk_size) },
+          { bound(cx, reg.get_width()), bound(cy, reg.get_height()), bound(cz, reg.get_depth()) }
+        };
+      }
+
+      size_t get_unit_size() const
+      { return m_unit_size; }
+
+      /* Simplifies each chunk as it's extracted, down to ratio of its
+       * triangles, so long as no collapse costs more than max_error;
+       * that's a sum of squared distances, in cells. A ratio of 1
+       * turns simplification off. Takes effect on the next extraction. */
+      void set_simplification(float const ratio, float const max_error)
+      {
+        m_simplify_ratio = ratio;
+        m_simplify_error = max_error;
+      }
+
+    private:
+      /* A chunk's surface and the buffers its extractions reuse.
+       * Only one of the scratches is used, by whether chunks are
+       * meshed through a lod_field. */
+      struct chunk
+      {
+        std::unique_ptr<surface_t> surface;
+        extractor_scratch<value_t> scratch;
+        extractor_scratch<typename lod_field<Volume>::value_t> field_scratch;
+        size_t generation{};
+      };
+
+      /* Empties the chunk over its region, which moves with its
+       * level, keeping its storage. */
+      void reset_chunk(size_t const index)
+      {
+        auto &c(m_chunks[index]);
+        auto const reg(get_chunk_region(index));
+        c.surface.reset(c.surface ? new surface_t(reg, std::move(*c.surface)) : new surface_t(reg));
+        c.generation = ++m_generation;
+      }
+
+      size_t chunk_index(size_t const cx, size_t const cy, size_t const cz) const
+      { return ((cx * m_chunks_y) + cy) * m_chunks_z + cz; }
+
+      /* Chunk c reads the voxels in [c * S, (c + 1) * S], at any level
+       * and through any seam; find the chunks reading [lower, upper). */
+      bool chunks_reading(region::value_t const lower, region::value_t const upper,
+                          size_t const chunks, size_t &first, size_t &last) const
+      {
+        if(upper <= lower || chunks == 0)
+        { return false; }
+
+        auto const from(std::max<region::value_t>(0, lower - 1));
+        first = static_cast<size_t>(from) / m_chunk_size;
+        last = std::min(static_cast<size_t>(upper - 1) / m_chunk_size, chunks - 1);
+        return first <= last;
+      }
+
+      uint8_t choose_level(vec3<float> const &eye, float const distance,
+                           size_t const cx, size_t const cy, size_t const cz) const
+      {
+        auto const gap([this](float const e, size_t const c)
+        {
+          float const lower(c * m_chunk_size), upper((c + 1) * m_chunk_size);
+          return e < lower ? lower - e : (e > upper ? e - upper : 0.0f);
+        });
+        float const dx{ gap(eye.x, cx) }, dy{ gap(eye.y, cy) }, dz{ gap(eye.z, cz) };
+        float const d{ std::sqrt(dx * dx + dy * dy + dz * dz) };
+
+        uint8_t level{};
+        while(level + 1u < m_lod_levels && d >= distance * (1 << level))
+        { ++level; }
+        return level;
+      }
+
+      void extract(std::vector<size_t> const &indices, util::thread_pool &pool)
+      {
+        using field_t = lod_field<Volume>;
+        field_t const field
+        {
+          m_volume, m_unit_size, m_chunk_size,
+          { m_chunks_x, m_chunks_y, m_chunks_z }, m_levels, m_lod_levels - 1
+        };
+
+        for(auto const index : indices)
+        { m_chunks[index].generation = ++m_generation; }
+
+        /* Each task writes only its own chunk. */
+        std::vector<std::future<void>> futs;
+        futs.reserve(indices.size());
+        for(auto const index : indices)
+        {
+          futs.push_back(pool.submit([this, &field, index]
+          {
+            auto &c(m_chunks[index]);
+            auto &chunk(*c.surface);
+            if(m_lod_levels == 1 && mip_query<Volume>::level_for(m_volume, m_unit_size))
+            {
+              mip_view<Volume> const view{ m_volume, m_unit_size };
+              surface_extractor<Triangle, mip_view<Volume>> const extractor
+              { view, chunk.get_region(), m_iso_level, m_unit_size };
+              extractor(chunk, c.scratch);
+            }
+            else if(m_lod_levels == 1)
+            {
+              extractor_t const extractor
+              { m_volume, chunk.get_region(), m_iso_level, m_unit_size };
+              extractor(chunk, c.scratch);
+            }
+            else
+            {
+              surface_extractor<Triangle, field_t> const extractor
+              {
+                field, chunk.get_region(), static_cast<float>(m_iso_level),
+                m_unit_size << m_levels[index], polygonizer::transitions
+              };
+              extractor(chunk, c.field_scratch);
+            }
+            simplify(chunk, m_levels[index]);
+          }));
+        }
+        for(auto &f : futs)
+        { f.get(); }
+      }
+
+      /* Runs on the chunk's own task. Vertices on the faces of the
+       * chunk's lattice are locked, as are those on open edges. */
+      void simplify(surface_t &chunk, size_t const level)
+      {
+        if(m_simplify_ratio >= 1.0f)
+        { return; }
+
+        using simplifier_t = simplifier<typename Triangle::vertex_t>;
+        auto const &reg(chunk.get_region());
+        float const unit(m_unit_size << level);
+        simplifier_t simp{ simplifier_t::weld(chunk, 1.0f / 1024.0f) };
+        simp.lock_outside({ static_cast<float>(reg.lower_corner.x),
+                            static_cast<float>(reg.lower_corner.y),
+                            static_cast<float>(reg.lower_corner.z) },
+                          { reg.upper_corner.x - unit,
+                            reg.upper_corner.y - unit,
+                            reg.upper_corner.z - unit });
+        simp.simplify(static_cast<size_t>(chunk.get_triangles().size() * m_simplify_ratio),
+                      m_simplify_error * unit * unit);
+        simp.get_triangles(chunk);
+      }
+
+      Volume const &m_volume;
+      value_t const m_iso_level;
+      size_t const m_chunk_voxels;
+      size_t const m_lod_levels;
+      size_t m_unit_size{}, m_chunk_size{};
+      size_t m_chunks_x{}, m_chunks_y{}, m_chunks_z{};
+      std::vector<uint8_t> m_levels;
+      std::vector<chunk> m_chunks;
+      size_t m_generation{};
+      float m_simplify_ratio{ 1.0f }, m_simplify_error{};
+  };
+}
@@ -0,0 +1,80 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/indexed_surface.h
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    A surface stored as a vertex array and a triangle
+    list of indices into it; vertices shared between
+    triangles are stored once.
+*/
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "region.h"
+
+namespace vox
+{
+  template <typename Vertex>
+  class indexed_surface
+  {
+    public:
+      using vertex_t = Vertex;
+      using index_t = uint32_t;
+
+      indexed_surface(region const &reg)
+        : m_region(reg)
+      { }
+      indexed_surface(indexed_surface const &) = default;
+      indexed_surface(indexed_surface &&surf)
+        : m_vertices(std::move(surf.m_vertices))
+        , m_indices(std::move(surf.m_indices))
+        , m_region(surf.m_region)
+      { }
+      indexed_surface& operator =(indexed_surface const &) = delete;
+
+      index_t add_vertex(vertex_t const &vert)
+      {
+        m_vertices.push_back(vert);
+        return static_cast<index_t>(m_vertices.size() - 1);
+      }
+
+      void add_triangle(index_t const a, index_t const b, index_t const c)
+      {
+        m_indices.push_back(a);
+        m_indices.push_back(b);
+        m_indices.push_back(c);
+      }
+
+      /* Appends another surface, rebasing its indices. */
+      void add_surface(indexed_surface const &surf)
+      {
+        auto const base(static_cast<index_t>(m_vertices.size()));
+        m_vertices.insert(m_vertices.end(), surf.m_vertices.begin(), surf.m_vertices.end());
+        m_indices.reserve(m_indices.size() + surf.m_indices.size());
+        for(auto const index : surf.m_indices)
+        { m_indices.push_back(base + index); }
+      }
+
+      std::vector<vertex_t> const& get_vertices() const
+      { return m_vertices; }
+      std::vector<index_t> const& get_indices() const
+      { return m_indices; }
+
+      size_t get_triangle_count() const
+      { return m_indices.size() / 3; }
+
+      region const& get_region() const
+      { return m_region; }
+
+    private:
+      std::vector<vertex_t> m_vertices;
+      std::vector<index_t> m_indices;
+      region const m_region;
+  };
+}
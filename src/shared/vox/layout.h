@@ -0,0 +1,130 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/layout.h
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    Storage layouts for flat volumes. A layout maps
+    (x, y, z) onto an offset within a single contiguous
+    allocation and knows how large that allocation
+    needs to be.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+
+namespace vox
+{
+  namespace layout
+  {
+    /* x-major, z-minor; matches the old [x][y][z] nesting.
+     * Every (x, y) pair owns a contiguous run along z. */
+    class xyz
+    {
+      public:
+        static bool constexpr const linear{ true };
+        /* Identifies the ordering in saved volumes; see volume_file.h. */
+        static uint32_t constexpr const tag{ 1 };
+
+        xyz(size_t const width, size_t const height, size_t const depth)
+          : m_width(width), m_height(height), m_depth(depth)
+        { }
+
+        size_t index(size_t const x, size_t const y, size_t const z) const
+        { return ((x * m_height) + y) * m_depth + z; }
+
+        size_t capacity() const
+        { return m_width * m_height * m_depth; }
+
+        /* Runs are indexed by the two slow axes. */
+        size_t run_index(size_t const x, size_t const y) const
+        { return index(x, y, 0); }
+        size_t run_length() const
+        { return m_depth; }
+        /* How many runs there are along each of those axes. */
+        size_t run_rows() const
+        { return m_width; }
+        size_t run_columns() const
+        { return m_height; }
+
+      private:
+        size_t m_width{}, m_height{}, m_depth{};
+    };
+
+    /* y-major, x-minor. Every (y, z) pair owns a
+     * contiguous run along x, which keeps horizontal
+     * slices of the world together. */
+    class yzx
+    {
+      public:
+        static bool constexpr const linear{ true };
+        static uint32_t constexpr const tag{ 2 };
+
+        yzx(size_t const width, size_t const height, size_t const depth)
+          : m_width(width), m_height(height), m_depth(depth)
+        { }
+
+        size_t index(size_t const x, size_t const y, size_t const z) const
+        { return ((y * m_depth) + z) * m_width + x; }
+
+        size_t capacity() const
+        { return m_width * m_height * m_depth; }
+
+        size_t run_index(size_t const y, size_t const z) const
+        { return index(0, y, z); }
+        size_t run_length() const
+        { return m_width; }
+        size_t run_rows() const
+        { return m_height; }
+        size_t run_columns() const
+        { return m_depth; }
+
+      private:
+        size_t m_width{}, m_height{}, m_depth{};
+    };
+
+    /* Cubic bricks of Size^3 voxels, stored brick after brick
+     * in x-major order. Within a brick, voxels are x-major too.
+     * Neighbours along any axis are usually within the same
+     * few cache lines. The volume is padded up to whole bricks. */
+    template <size_t Size = 8>
+    class tiled
+    {
+      static_assert(Size && !(Size & (Size - 1)), "Brick size must be a power of two");
+
+      public:
+        static bool constexpr const linear{ false };
+        static uint32_t constexpr const tag{ 0x100 | Size };
+        static size_t constexpr const brick_size{ Size };
+        static size_t constexpr const brick_volume{ Size * Size * Size };
+
+        tiled(size_t const width, size_t const height, size_t const depth)
+          : m_bricks_y((height + Size - 1) / Size)
+          , m_bricks_z((depth + Size - 1) / Size)
+          , m_bricks(((width + Size - 1) / Size) * m_bricks_y * m_bricks_z)
+        { }
+
+        size_t index(size_t const x, size_t const y, size_t const z) const
+        {
+          size_t const brick{ ((x / Size) * m_bricks_y + (y / Size)) * m_bricks_z + (z / Size) };
+          size_t const local{ (((x & mask) * Size) + (y & mask)) * Size + (z & mask) };
+          return brick * brick_volume + local;
+        }
+
+        size_t capacity() const
+        { return m_bricks * brick_volume; }
+
+        size_t brick_count() const
+        { return m_bricks; }
+
+      private:
+        static size_t constexpr const mask{ Size - 1 };
+
+        size_t m_bricks_y{}, m_bricks_z{}, m_bricks{};
+    };
+  }
+}
@@ -0,0 +1,229 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/lod_field.h
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    Presents a volume as seen by a grid of chunks which are
+    each meshed at their own level of detail. A voxel on a
+    face shared with coarser chunks takes the value which
+    the coarsest of them interpolates there, so both sides
+    of the face see the same field and their surfaces meet.
+    Given a mip chain, each chunk reads the level matching
+    its lattice; see mip_view.h.
+*/
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "region.h"
+#include "range_query.h"
+#include "mip_view.h"
+
+namespace vox
+{
+  /*
+     Across a face between levels, each coarse square is split along
+     its lower-to-upper diagonal, and the squares of a finer lattice
+     nest within those triangles. The field within each triangle is
+     linear; as long as the cells on both sides of the face split it
+     the same way (see polygonizer::transitions), finer chunks
+     sampling it at their own lattice points trace exactly the same
+     contour across the face. is_seam() says which faces those are.
+  */
+  template <typename Volume>
+  class lod_field
+  {
+    public:
+      using value_t = float;
+
+      /* Chunk (cx, cy, cz) has its level at
+       * levels[((cx * chunks_y) + cy) * chunks_z + cz] and samples
+       * every (unit << level) voxels. */
+      lod_field(Volume const &vol, size_t const unit, size_t const chunk_size,
+                vec3<size_t> const &chunks, std::vector<uint8_t> const &levels,
+                size_t const max_level)
+        : m_volume(vol)
+        , m_unit_size(unit)
+        , m_chunk_size(chunk_size)
+        , m_chunks(chunks)
+        , m_levels(levels)
+        , m_max_level(max_level)
+      { }
+
+      value_t operator ()(size_t const x, size_t const y, size_t const z) const
+      {
+        /* Off every chunk face, only one chunk reads the voxel. */
+        size_t const cx{ x / m_chunk_size }, cy{ y / m_chunk_size }, cz{ z / m_chunk_size };
+        if(x - cx * m_chunk_size && y - cy * m_chunk_size && z - cz * m_chunk_size)
+        {
+          auto const level(m_levels[((std::min(cx, m_chunks.x - 1) * m_chunks.y) +
+                                     std::min(cy, m_chunks.y - 1)) * m_chunks.z +
+                                    std::min(cz, m_chunks.z - 1)]);
+          return sample(x, y, z, m_unit_size << level);
+        }
+        return shared(x, y, z);
+      }
+
+      /* Interpolated values never leave the range of the lattice points
+       * they come from, which are at most one coarsest step away. */
+      bool get_range(region const &reg, value_t &min, value_t &max) const
+      {
+        using v = region::value_t;
+        auto const &bounds(m_volume.get_region());
+        v const apron(static_cast<v>(m_unit_size << m_max_level));
+        region const grown
+        {
+          { std::max(bounds.lower_corner.x, reg.lower_corner.x - apron),
+            std::max(bounds.lower_corner.y, reg.lower_corner.y - apron),
+            std::max(bounds.lower_corner.z, reg.lower_corner.z - apron) },
+          { std::min(bounds.upper_corner.x, reg.upper_corner.x + apron),
+            std::min(bounds.upper_corner.y, reg.upper_corner.y + apron),
+            std::min(bounds.upper_corner.z, reg.upper_corner.z + apron) }
+        };
+
+        typename Volume::value_t low{}, high{};
+        if(!range_query<Volume>::get(m_volume, grown, low, high))
+        { return false; }
+        min = low;
+        max = high;
+        return true;
+      }
+
+      region const& get_region() const
+      { return m_volume.get_region(); }
+
+      /* Whether the cell face at (x, y, z), facing along axis, lies
+       * between chunks of different levels. Faces never straddle
+       * chunks, so the chunks beside the face's lowest corner are
+       * the ones either side of all of it. */
+      bool is_seam(size_t const x, size_t const y, size_t const z, size_t const axis) const
+      {
+        size_t const p[3]{ x, y, z };
+        size_t const chunks[3]{ m_chunks.x, m_chunks.y, m_chunks.z };
+        if(p[axis] % m_chunk_size)
+        { return false; }
+
+        size_t c[3];
+        for(size_t a{}; a < 3; ++a)
+        { c[a] = std::min(p[a] / m_chunk_size, chunks[a] - 1); }
+        c[axis] = p[axis] / m_chunk_size;
+        if(c[axis] == 0 || c[axis] >= chunks[axis])
+        { return false; }
+
+        auto const level([this](size_t const (&at)[3])
+        { return m_levels[((at[0] * m_chunks.y) + at[1]) * m_chunks.z + at[2]]; });
+        size_t lower[3]{ c[0], c[1], c[2] };
+        --lower[axis];
+        return level(lower) != level(c);
+      }
+
+    private:
+      /* A voxel on at least one chunk face; the coarsest chunk sharing
+       * it decides its value. Faces lie on every level's lattice, so at
+       * most the two axes along the face can be off the coarse lattice. */
+      value_t shared(size_t const x, size_t const y, size_t const z) const
+      {
+        size_t const unit{ m_unit_size << get_shared_level(x, y, z) };
+        size_t const p[3]{ x, y, z };
+        size_t off[2]{}, count{};
+        for(size_t a{}; a < 3; ++a)
+        {
+          if(p[a] % unit)
+          { off[count++] = a; }
+        }
+        if(count == 0)
+        { return sample(x, y, z, unit); }
+
+        size_t lower[3]{ x, y, z };
+        for(size_t i{}; i < count; ++i)
+        { lower[off[i]] -= p[off[i]] % unit; }
+
+        /* The value at a coarse lattice point, du and dv steps along the
+         * off-lattice axes from the lower one. */
+        auto const at([&](size_t const du, size_t const dv)
+        {
+          size_t q[3]{ lower[0], lower[1], lower[2] };
+          q[off[0]] += du * unit;
+          q[off[1]] += dv * unit;
+          return corner(q[0], q[1], q[2], unit);
+        });
+        if(count == 1)
+        { off[1] = off[0]; }
+
+        /* Along an edge of the coarse lattice. */
+        float const s{ static_cast<float>(p[off[0]] - lower[off[0]]) / unit };
+        value_t const v00{ at(0, 0) }, v10{ at(1, 0) };
+        if(count == 1)
+        { return v00 + s * (v10 - v00); }
+
+        /* Within a coarse square; pick the triangle on our side of its diagonal. */
+        float const t{ static_cast<float>(p[off[1]] - lower[off[1]]) / unit };
+        value_t const v01{ at(0, 1) }, v11{ at(1, 1) };
+        if(s >= t)
+        { return v00 + s * (v10 - v00) + t * (v11 - v10); }
+        return v00 + t * (v01 - v00) + s * (v11 - v01);
+      }
+
+      /* Lattice points may themselves lie on coarser faces. Those past
+       * the volume's edge are clamped; nothing meshes across it. */
+      value_t corner(size_t const x, size_t const y, size_t const z, size_t const unit) const
+      {
+        auto const &reg(m_volume.get_region());
+        size_t const last[3]
+        {
+          static_cast<size_t>(reg.get_width() - 1),
+          static_cast<size_t>(reg.get_height() - 1),
+          static_cast<size_t>(reg.get_depth() - 1)
+        };
+        if(x > last[0] || y > last[1] || z > last[2])
+        { return sample(std::min(x, last[0]), std::min(y, last[1]), std::min(z, last[2]), unit); }
+        return (*this)(x, y, z);
+      }
+
+      /* A lattice point of unit, from the matching mip level. */
+      value_t sample(size_t const x, size_t const y, size_t const z, size_t const unit) const
+      {
+        using mips = mip_query<Volume>;
+        return mips::sample(m_volume, x, y, z, mips::level_for(m_volume, unit));
+      }
+
+      /* The coarsest level among the (up to eight) chunks whose
+       * closed bounds hold the voxel. */
+      size_t get_shared_level(size_t const x, size_t const y, size_t const z) const
+      {
+        size_t lower_x, upper_x, lower_y, upper_y, lower_z, upper_z;
+        chunks_holding(x, m_chunks.x, lower_x, upper_x);
+        chunks_holding(y, m_chunks.y, lower_y, upper_y);
+        chunks_holding(z, m_chunks.z, lower_z, upper_z);
+
+        uint8_t level{};
+        for(size_t cx{ lower_x }; cx <= upper_x; ++cx)
+        {
+          for(size_t cy{ lower_y }; cy <= upper_y; ++cy)
+          {
+            for(size_t cz{ lower_z }; cz <= upper_z; ++cz)
+            { level = std::max(level, m_levels[((cx * m_chunks.y) + cy) * m_chunks.z + cz]); }
+          }
+        }
+        return level;
+      }
+
+      void chunks_holding(size_t const p, size_t const chunks,
+                          size_t &first, size_t &last) const
+      {
+        last = std::min(p / m_chunk_size, chunks - 1);
+        first = (p % m_chunk_size == 0 && p > 0) ? std::min(p / m_chunk_size - 1, last) : last;
+      }
+
+      Volume const &m_volume;
+      size_t const m_unit_size, m_chunk_size;
+      vec3<size_t> const m_chunks;
+      std::vector<uint8_t> const &m_levels;
+      size_t const m_max_level;
+  };
+}
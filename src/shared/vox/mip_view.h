@@ -0,0 +1,123 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/mip_view.h
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    Lets the extractors sample a coarse lattice from the
+    matching level of a volume's mip chain, rather than
+    picking scattered voxels out of the full resolution
+    data. Volumes opt in by providing:
+
+      size_t get_mip_count() const;
+      Volume const& get_mip(size_t level) const;
+
+    where voxel (x, y, z) of level l sits on voxel
+    (x << l, y << l, z << l) of level 0. See fixed_volume.h.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+#include <algorithm>
+
+#include "region.h"
+#include "range_query.h"
+
+namespace vox
+{
+  /* Fallback; there's only the one level. */
+  template <typename Volume, typename Enable = void>
+  struct mip_query
+  {
+    using value_t = typename Volume::value_t;
+
+    static size_t level_for(Volume const &, size_t const)
+    { return 0; }
+    static value_t sample(Volume const &vol, size_t const x, size_t const y,
+                          size_t const z, size_t const)
+    { return vol(x, y, z); }
+    static Volume const& get_level(Volume const &vol, size_t const)
+    { return vol; }
+  };
+
+  template <typename Volume>
+  struct mip_query<Volume, decltype(void(std::declval<Volume const&>().get_mip_count()))>
+  {
+    using value_t = typename Volume::value_t;
+
+    /* The coarsest level with a voxel on every multiple of unit. */
+    static size_t level_for(Volume const &vol, size_t const unit)
+    {
+      size_t const aligned(unit ? __builtin_ctzll(unit) : 0);
+      return std::min(aligned, vol.get_mip_count() - 1);
+    }
+
+    /* Reads from level, or from the coarsest level below it
+     * with a voxel on (x, y, z). */
+    static value_t sample(Volume const &vol, size_t const x, size_t const y,
+                          size_t const z, size_t const level)
+    {
+      size_t const l(std::min<size_t>(level, __builtin_ctzll(x | y | z | (size_t{ 1 } << level))));
+      return vol.get_mip(l)(x >> l, y >> l, z >> l);
+    }
+
+    static Volume const& get_level(Volume const &vol, size_t const level)
+    { return vol.get_mip(level); }
+  };
+
+  /* Presents the level matching a lattice in level 0's
+   * coordinates, so extractors run on it unchanged. */
+  template <typename Volume>
+  class mip_view
+  {
+    public:
+      using value_t = typename Volume::value_t;
+
+      mip_view(Volume const &vol, size_t const unit)
+        : m_volume(vol)
+        , m_level(mip_query<Volume>::level_for(vol, unit))
+        , m_mask((size_t{ 1 } << m_level) - 1)
+        , m_mip(mip_query<Volume>::get_level(vol, m_level))
+      { }
+
+      /* Lattice points are read straight from the level. */
+      value_t operator ()(size_t const x, size_t const y, size_t const z) const
+      {
+        if(((x | y | z) & m_mask) == 0)
+        { return m_mip(x >> m_level, y >> m_level, z >> m_level); }
+        return mip_query<Volume>::sample(m_volume, x, y, z, m_level);
+      }
+
+      /* Over the level's voxels within the box; those are the
+       * lattice points, which is all the extractors read. */
+      bool get_range(region const &reg, value_t &min, value_t &max) const
+      {
+        using v = region::value_t;
+        v const mask(static_cast<v>(m_mask));
+        region const level
+        {
+          { (reg.lower_corner.x + mask) >> m_level, (reg.lower_corner.y + mask) >> m_level,
+            (reg.lower_corner.z + mask) >> m_level },
+          { ((reg.upper_corner.x - 1) >> m_level) + 1, ((reg.upper_corner.y - 1) >> m_level) + 1,
+            ((reg.upper_corner.z - 1) >> m_level) + 1 }
+        };
+        return range_query<Volume>::get(m_mip, level, min, max);
+      }
+
+      region const& get_region() const
+      { return m_volume.get_region(); }
+
+      size_t get_level() const
+      { return m_level; }
+
+    private:
+      Volume const &m_volume;
+      size_t const m_level, m_mask;
+      Volume const &m_mip;
+  };
+}
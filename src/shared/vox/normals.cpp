@@ -0,0 +1,170 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/normals.cpp
+  Author: Jesse 'Jeaye' Wilkerson
+*/
+
+#include "normals.h"
+
+/* SSE2 is always there on x86-64. AVX is compiled per
+ * function and only used if the CPU reports it. */
+#if defined(__x86_64__) && defined(__GNUC__)
+  #define VOX_NORMALS_SSE2
+  #define VOX_NORMALS_AVX
+  #include <immintrin.h>
+#endif
+
+namespace vox
+{
+  namespace normals
+  {
+    namespace
+    {
+      using face_t = void (*)(corners const&, size_t const, size_t const,
+                              float*, float*, float*);
+
+      struct kernel
+      {
+        char const *name;
+        face_t face;
+      };
+
+      /*** Scalar. ***/
+      void face_scalar(corners const &tris, size_t const first, size_t const count,
+                       float *nx, float *ny, float *nz)
+      {
+        for(size_t i{ first }; i < count; ++i)
+        {
+          auto const n(normals::face({ tris.x[0][i], tris.y[0][i], tris.z[0][i] },
+                                     { tris.x[1][i], tris.y[1][i], tris.z[1][i] },
+                                     { tris.x[2][i], tris.y[2][i], tris.z[2][i] }));
+          nx[i] = n.x;
+          ny[i] = n.y;
+          nz[i] = n.z;
+        }
+      }
+
+#ifdef VOX_NORMALS_SSE2
+      /*** SSE2; always present on x86-64. ***/
+      void face4_sse2(corners const &tris, size_t const i,
+                      float *nx, float *ny, float *nz)
+      {
+        __m128 const x1(_mm_loadu_ps(tris.x[1] + i));
+        __m128 const y1(_mm_loadu_ps(tris.y[1] + i));
+        __m128 const z1(_mm_loadu_ps(tris.z[1] + i));
+        __m128 const ax(_mm_sub_ps(_mm_loadu_ps(tris.x[0] + i), x1));
+        __m128 const ay(_mm_sub_ps(_mm_loadu_ps(tris.y[0] + i), y1));
+        __m128 const az(_mm_sub_ps(_mm_loadu_ps(tris.z[0] + i), z1));
+        __m128 const bx(_mm_sub_ps(x1, _mm_loadu_ps(tris.x[2] + i)));
+        __m128 const by(_mm_sub_ps(y1, _mm_loadu_ps(tris.y[2] + i)));
+        __m128 const bz(_mm_sub_ps(z1, _mm_loadu_ps(tris.z[2] + i)));
+
+        __m128 const cx(_mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(az, by)));
+        __m128 const cy(_mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(ax, bz)));
+        __m128 const cz(_mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(ay, bx)));
+        __m128 const length(_mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, cx),
+                                                              _mm_mul_ps(cy, cy)),
+                                                   _mm_mul_ps(cz, cz))));
+
+        /* Degenerate faces keep their zero cross product. */
+        __m128 const valid(_mm_cmpgt_ps(length, _mm_setzero_ps()));
+        __m128 const divisor(_mm_or_ps(_mm_and_ps(valid, length),
+                                       _mm_andnot_ps(valid, _mm_set1_ps(1.0f))));
+        _mm_storeu_ps(nx + i, _mm_div_ps(cx, divisor));
+        _mm_storeu_ps(ny + i, _mm_div_ps(cy, divisor));
+        _mm_storeu_ps(nz + i, _mm_div_ps(cz, divisor));
+      }
+
+      void face_sse2(corners const &tris, size_t const first, size_t const count,
+                     float *nx, float *ny, float *nz)
+      {
+        size_t i{ first };
+        for(; i + 8 <= count; i += 8)
+        {
+          face4_sse2(tris, i, nx, ny, nz);
+          face4_sse2(tris, i + 4, nx, ny, nz);
+        }
+        for(; i + 4 <= count; i += 4)
+        { face4_sse2(tris, i, nx, ny, nz); }
+        face_scalar(tris, i, count, nx, ny, nz);
+      }
+#endif
+
+#ifdef VOX_NORMALS_AVX
+      /*** AVX. ***/
+      __attribute__((target("avx")))
+      void face8_avx(corners const &tris, size_t const i,
+                     float *nx, float *ny, float *nz)
+      {
+        __m256 const x1(_mm256_loadu_ps(tris.x[1] + i));
+        __m256 const y1(_mm256_loadu_ps(tris.y[1] + i));
+        __m256 const z1(_mm256_loadu_ps(tris.z[1] + i));
+        __m256 const ax(_mm256_sub_ps(_mm256_loadu_ps(tris.x[0] + i), x1));
+        __m256 const ay(_mm256_sub_ps(_mm256_loadu_ps(tris.y[0] + i), y1));
+        __m256 const az(_mm256_sub_ps(_mm256_loadu_ps(tris.z[0] + i), z1));
+        __m256 const bx(_mm256_sub_ps(x1, _mm256_loadu_ps(tris.x[2] + i)));
+        __m256 const by(_mm256_sub_ps(y1, _mm256_loadu_ps(tris.y[2] + i)));
+        __m256 const bz(_mm256_sub_ps(z1, _mm256_loadu_ps(tris.z[2] + i)));
+
+        __m256 const cx(_mm256_sub_ps(_mm256_mul_ps(ay, bz), _mm256_mul_ps(az, by)));
+        __m256 const cy(_mm256_sub_ps(_mm256_mul_ps(az, bx), _mm256_mul_ps(ax, bz)));
+        __m256 const cz(_mm256_sub_ps(_mm256_mul_ps(ax, by), _mm256_mul_ps(ay, bx)));
+        __m256 const length(_mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, cx),
+                                                                       _mm256_mul_ps(cy, cy)),
+                                                         _mm256_mul_ps(cz, cz))));
+
+        __m256 const valid(_mm256_cmp_ps(length, _mm256_setzero_ps(), _CMP_GT_OQ));
+        __m256 const divisor(_mm256_blendv_ps(_mm256_set1_ps(1.0f), length, valid));
+        _mm256_storeu_ps(nx + i, _mm256_div_ps(cx, divisor));
+        _mm256_storeu_ps(ny + i, _mm256_div_ps(cy, divisor));
+        _mm256_storeu_ps(nz + i, _mm256_div_ps(cz, divisor));
+      }
+
+      __attribute__((target("avx")))
+      void face_avx(corners const &tris, size_t const first, size_t const count,
+                    float *nx, float *ny, float *nz)
+      {
+        size_t i{ first };
+        for(; i + 16 <= count; i += 16)
+        {
+          face8_avx(tris, i, nx, ny, nz);
+          face8_avx(tris, i + 8, nx, ny, nz);
+        }
+
+        /* Avoid the AVX to SSE transition penalty in the tail. */
+        _mm256_zeroupper();
+        face_sse2(tris, i, count, nx, ny, nz);
+      }
+#endif
+
+      kernel select()
+      {
+#ifdef VOX_NORMALS_AVX
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx"))
+        { return { "avx", face_avx }; }
+#endif
+#ifdef VOX_NORMALS_SSE2
+        return { "sse2", face_sse2 };
+#else
+        return { "scalar", face_scalar };
+#endif
+      }
+
+      kernel const& get_kernel()
+      {
+        static kernel const k(select());
+        return k;
+      }
+    }
+
+    void face(corners const &tris, size_t const count, float *nx, float *ny, float *nz)
+    { get_kernel().face(tris, 0, count, nx, ny, nz); }
+
+    char const* get_kernel_name()
+    { return get_kernel().name; }
+  }
+}
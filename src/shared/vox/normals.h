@@ -0,0 +1,59 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/normals.h
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    Face normals, computed in one pass over a batch of
+    triangles once they've all been extracted, rather than
+    one at a time as each is made. The batch is held as
+    structure of arrays, a run of floats per corner and
+    axis, so a vector lane is a triangle; the kernel is
+    picked at runtime.
+*/
+
+#pragma once
+
+#include <cmath>
+#include <cstdlib>
+
+#include "vec3.h"
+
+namespace vox
+{
+  namespace normals
+  {
+    /* Corner c of triangle i is (x[c][i], y[c][i], z[c][i]). */
+    struct corners
+    {
+      float const *x[3];
+      float const *y[3];
+      float const *z[3];
+    };
+
+    /* The unit normal of the face wound p0, p1, p2; degenerate
+     * faces get a zero normal. */
+    inline vec3<float> face(vec3<float> const &p0, vec3<float> const &p1,
+                            vec3<float> const &p2)
+    {
+      float const ax{ p0.x - p1.x }, ay{ p0.y - p1.y }, az{ p0.z - p1.z };
+      float const bx{ p1.x - p2.x }, by{ p1.y - p2.y }, bz{ p1.z - p2.z };
+      vec3<float> n{ ay * bz - az * by, az * bx - ax * bz, ax * by - ay * bx };
+      float const length{ std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z) };
+      if(length > 0.0f)
+      {
+        n.x /= length;
+        n.y /= length;
+        n.z /= length;
+      }
+      return n;
+    }
+
+    /* (nx[i], ny[i], nz[i]) = face() of triangle i. */
+    void face(corners const &tris, size_t const count, float *nx, float *ny, float *nz);
+
+    char const* get_kernel_name();
+  }
+}
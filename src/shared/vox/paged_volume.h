@@ -0,0 +1,292 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/paged_volume.h
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    A sparse volume split into cubic chunks. Chunks
+    holding a single value are stored as just that value;
+    only chunks with mixed contents allocate voxels.
+*/
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <future>
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+
+#include "region.h"
+#include "span.h"
+#include "log/logger.h"
+
+namespace vox
+{
+  template <typename Value, size_t ChunkSize = 16>
+  class paged_volume
+  {
+    static_assert(ChunkSize && !(ChunkSize & (ChunkSize - 1)),
+                  "Chunk size must be a power of two");
+
+    public:
+      using value_t = Value;
+      static size_t constexpr const chunk_size{ ChunkSize };
+      static size_t constexpr const chunk_volume{ ChunkSize * ChunkSize * ChunkSize };
+
+      /* Generates one chunk's worth of voxels. The chunk's bounds
+       * are given in volume space and are clamped to the volume;
+       * voxels are x-major within the chunk: ((x * S) + y) * S + z. */
+      using fill_func_t = std::function<void (region const&, span<value_t>)>;
+
+      class chunk
+      {
+        public:
+          chunk() = default;
+          chunk(chunk &&) = default;
+          chunk& operator =(chunk &&) = default;
+
+          bool is_uniform() const
+          { return !m_data; }
+
+          value_t get(size_t const index) const
+          { return m_data ? m_data[index] : m_value; }
+
+          value_t get_min() const
+          { return m_min; }
+          value_t get_max() const
+          { return m_max; }
+
+        private:
+          friend class paged_volume;
+
+          std::unique_ptr<value_t[]> m_data;
+          value_t m_value{}, m_min{}, m_max{};
+      };
+
+      paged_volume(region const &size, value_t const value = value_t{})
+        : m_region(size)
+        , m_chunks_x(chunks_along(size.get_width()))
+        , m_chunks_y(chunks_along(size.get_height()))
+        , m_chunks_z(chunks_along(size.get_depth()))
+        , m_chunks(m_chunks_x * m_chunks_y * m_chunks_z)
+      {
+        for(auto &c : m_chunks)
+        { c.m_value = c.m_min = c.m_max = value; }
+      }
+
+      paged_volume(region const &size, fill_func_t const &func)
+        : paged_volume(size)
+      { fill(func); }
+
+      paged_volume(paged_volume const &) = delete;
+      paged_volume& operator =(paged_volume const &) = delete;
+
+      value_t at(size_t const x, size_t const y, size_t const z) const
+      {
+        if(x >= static_cast<size_t>(m_region.get_width()) ||
+           y >= static_cast<size_t>(m_region.get_height()) ||
+           z >= static_cast<size_t>(m_region.get_depth()))
+        { throw std::out_of_range("Voxel index out of volume bounds"); }
+        return (*this)(x, y, z);
+      }
+
+      /* Unchecked access; this is what the extractors use. */
+      value_t operator ()(size_t const x, size_t const y, size_t const z) const
+      {
+        return get_chunk(x / chunk_size, y / chunk_size, z / chunk_size)
+                .get(local_index(x & mask, y & mask, z & mask));
+      }
+
+      /* Writing into a uniform chunk allocates it. Chunks which
+       * become uniform again are only released by compact(). */
+      void set(size_t const x, size_t const y, size_t const z, value_t const value)
+      {
+        auto &c(m_chunks[chunk_index(x / chunk_size, y / chunk_size, z / chunk_size)]);
+        if(c.is_uniform())
+        {
+          if(value == c.m_value)
+          { return; }
+          c.m_data.reset(new value_t[chunk_volume]);
+          std::fill(c.m_data.get(), c.m_data.get() + chunk_volume, c.m_value);
+        }
+        c.m_data[local_index(x & mask, y & mask, z & mask)] = value;
+        c.m_min = std::min(c.m_min, value);
+        c.m_max = std::max(c.m_max, value);
+      }
+
+      /* Releases the storage of every chunk which holds a single value. */
+      void compact()
+      {
+        for(size_t cx{}; cx < m_chunks_x; ++cx)
+        {
+          for(size_t cy{}; cy < m_chunks_y; ++cy)
+          {
+            for(size_t cz{}; cz < m_chunks_z; ++cz)
+            {
+              auto &c(m_chunks[chunk_index(cx, cy, cz)]);
+              if(!c.is_uniform() && settle(c, chunk_bounds(cx, cy, cz)))
+              {
+                c.m_value = c.m_min;
+                c.m_data.reset();
+              }
+            }
+          }
+        }
+      }
+
+      chunk const& get_chunk(size_t const cx, size_t const cy, size_t const cz) const
+      { return m_chunks[chunk_index(cx, cy, cz)]; }
+
+      /* Chunk granular; see range_query.h. */
+      bool get_range(region const &reg, value_t &min, value_t &max) const
+      {
+        size_t const lower_x(std::max(reg.lower_corner.x, 0) / chunk_size);
+        size_t const lower_y(std::max(reg.lower_corner.y, 0) / chunk_size);
+        size_t const lower_z(std::max(reg.lower_corner.z, 0) / chunk_size);
+        size_t const upper_x(std::min(chunks_along(reg.upper_corner.x), m_chunks_x));
+        size_t const upper_y(std::min(chunks_along(reg.upper_corner.y), m_chunks_y));
+        size_t const upper_z(std::min(chunks_along(reg.upper_corner.z), m_chunks_z));
+        if(lower_x >= upper_x || lower_y >= upper_y || lower_z >= upper_z)
+        { return false; }
+
+        min = max = get_chunk(lower_x, lower_y, lower_z).m_min;
+        for(size_t cx{ lower_x }; cx < upper_x; ++cx)
+        {
+          for(size_t cy{ lower_y }; cy < upper_y; ++cy)
+          {
+            for(size_t cz{ lower_z }; cz < upper_z; ++cz)
+            {
+              auto const &c(get_chunk(cx, cy, cz));
+              min = std::min(min, c.m_min);
+              max = std::max(max, c.m_max);
+            }
+          }
+        }
+        return true;
+      }
+
+      size_t get_allocated_chunks() const
+      {
+        return std::count_if(m_chunks.begin(), m_chunks.end(),
+                             [](chunk const &c){ return !c.is_uniform(); });
+      }
+
+      /* Approximate bytes used, including the chunk table. */
+      size_t get_memory_usage() const
+      {
+        return (m_chunks.size() * sizeof(chunk)) +
+               (get_allocated_chunks() * chunk_volume * sizeof(value_t));
+      }
+
+      region const& get_region() const
+      { return m_region; }
+
+    private:
+      static size_t constexpr const mask{ ChunkSize - 1 };
+
+      static size_t chunks_along(region::value_t const length)
+      { return length > 0 ? (length + chunk_size - 1) / chunk_size : 0; }
+
+      static size_t local_index(size_t const x, size_t const y, size_t const z)
+      { return ((x * chunk_size) + y) * chunk_size + z; }
+
+      size_t chunk_index(size_t const cx, size_t const cy, size_t const cz) const
+      { return ((cx * m_chunks_y) + cy) * m_chunks_z + cz; }
+
+      region chunk_bounds(size_t const cx, size_t const cy, size_t const cz) const
+      {
+        using v = region::value_t;
+        return
+        {
+          { static_cast<v>(cx * chunk_size),
+            static_cast<v>(cy * chunk_size),
+            static_cast<v>(cz * chunk_size) },
+          { std::min(static_cast<v>((cx + 1) * chunk_size), m_region.get_width()),
+            std::min(static_cast<v>((cy + 1) * chunk_size), m_region.get_height()),
+            std::min(static_cast<v>((cz + 1) * chunk_size), m_region.get_depth()) }
+        };
+      }
+
+      /* Recomputes the range of an allocated chunk and returns whether
+       * every voxel within bounds is the same. Voxels past the
+       * volume's edge are ignored. */
+      bool settle(chunk &c, region const &bounds)
+      {
+        size_t const width(bounds.get_width());
+        size_t const height(bounds.get_height());
+        size_t const depth(bounds.get_depth());
+
+        c.m_min = c.m_max = c.m_data[0];
+        for(size_t x{}; x < width; ++x)
+        {
+          for(size_t y{}; y < height; ++y)
+          {
+            auto const * const run(c.m_data.get() + local_index(x, y, 0));
+            for(size_t z{}; z < depth; ++z)
+            {
+              c.m_min = std::min(c.m_min, run[z]);
+              c.m_max = std::max(c.m_max, run[z]);
+            }
+          }
+        }
+
+        return c.m_min == c.m_max;
+      }
+
+      void fill(fill_func_t const &func)
+      {
+        log_info("filling paged volume");
+        log_push();
+
+        /* Each worker owns whole x-slabs of chunks and a scratch chunk.
+         * Only chunks which turn out to be mixed keep their storage. */
+        size_t const threads{ std::max<size_t>(1, std::thread::hardware_concurrency()) };
+        std::vector<std::future<void>> futs;
+        futs.reserve(threads);
+        for(size_t i{}; i < threads; ++i)
+        {
+          futs.push_back(std::async(std::launch::async, [&, i]
+          {
+            std::unique_ptr<value_t[]> scratch;
+            for(size_t cx{ i }; cx < m_chunks_x; cx += threads)
+            {
+              for(size_t cy{}; cy < m_chunks_y; ++cy)
+              {
+                for(size_t cz{}; cz < m_chunks_z; ++cz)
+                {
+                  if(!scratch)
+                  { scratch.reset(new value_t[chunk_volume]()); }
+
+                  auto &c(m_chunks[chunk_index(cx, cy, cz)]);
+                  auto const bounds(chunk_bounds(cx, cy, cz));
+                  func(bounds, { scratch.get(), chunk_volume });
+
+                  c.m_data = std::move(scratch);
+                  if(settle(c, bounds))
+                  {
+                    c.m_value = c.m_min;
+                    scratch = std::move(c.m_data);
+                  }
+                }
+              }
+            }
+          }));
+        }
+        for(auto &f : futs)
+        { f.get(); }
+
+        log_info("allocated chunks: %%/%%", get_allocated_chunks(), m_chunks.size());
+        log_pop();
+        log_info("paged volume filled");
+      }
+
+      region const m_region;
+      size_t const m_chunks_x, m_chunks_y, m_chunks_z;
+      std::vector<chunk> m_chunks;
+  };
+}
@@ -0,0 +1,148 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/polygonize.h
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    Turns a classified cube into marching cubes triangles,
+    either by walking the tables at runtime or through one
+    straight-line emitter per case, expanded from the same
+    tables at compile time. surface_extractor uses the
+    emitters unless VOX_TABLE_POLYGONIZE is defined.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "tables.h"
+
+namespace vox
+{
+  /* The corners of each edge, in the order they're interpolated. */
+  int constexpr const polygonize_edge_table[12][2] =
+  {
+    { 0, 1 }, { 1, 2 }, { 2, 3 }, { 3, 0 },
+    { 4, 5 }, { 5, 6 }, { 6, 7 }, { 7, 4 },
+    { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }
+  };
+
+  /* Hands the triangles of a cube to sink(Triangle const&).
+   * make(a, b) returns the vertex where the surface crosses the
+   * edge from corner a to corner b. */
+  template <typename Triangle, typename Make, typename Sink>
+  void polygonize_tables(int32_t const cube_index, Make const &make, Sink &sink)
+  {
+    int const edges{ edge_table[cube_index] };
+    if(edges == 0)
+    { return; }
+
+    typename Triangle::vertex_t verts[12];
+    for(size_t e{}; e < 12; ++e)
+    {
+      if(edges & (1 << e))
+      { verts[e] = make(polygonize_edge_table[e][0], polygonize_edge_table[e][1]); }
+    }
+
+    for(size_t i{}; tri_table[cube_index][i] != -1; i += 3)
+    {
+      sink(Triangle(verts[tri_table[cube_index][i]],
+                    verts[tri_table[cube_index][i + 1]],
+                    verts[tri_table[cube_index][i + 2]]));
+    }
+  }
+
+  namespace detail
+  {
+    template <size_t... Ns>
+    struct indices
+    { };
+    template <size_t N, size_t... Ns>
+    struct make_indices : make_indices<N - 1, N - 1, Ns...>
+    { };
+    template <size_t... Ns>
+    struct make_indices<0, Ns...>
+    { using type = indices<Ns...>; };
+
+    /* Interpolates edge E of case C, if the surface crosses it. */
+    template <size_t C, size_t E, bool Crossed = (edge_table[C] & (1 << E)) != 0>
+    struct edge_vertex
+    {
+      template <typename Vertex, typename Make>
+      static void fill(Vertex (&)[12], Make const &)
+      { }
+    };
+    template <size_t C, size_t E>
+    struct edge_vertex<C, E, true>
+    {
+      template <typename Vertex, typename Make>
+      static void fill(Vertex (&verts)[12], Make const &make)
+      { verts[E] = make(polygonize_edge_table[E][0], polygonize_edge_table[E][1]); }
+    };
+
+    /* Emits the triangles of case C from the I'th entry on. */
+    template <size_t C, size_t I, bool Done = tri_table[C][I] == -1>
+    struct case_triangles
+    {
+      template <typename Triangle, typename Vertex, typename Sink>
+      static void emit(Vertex const (&verts)[12], Sink &sink)
+      {
+        sink(Triangle(verts[tri_table[C][I]], verts[tri_table[C][I + 1]],
+                      verts[tri_table[C][I + 2]]));
+        case_triangles<C, I + 3>::template emit<Triangle>(verts, sink);
+      }
+    };
+    template <size_t C, size_t I>
+    struct case_triangles<C, I, true>
+    {
+      template <typename Triangle, typename Vertex, typename Sink>
+      static void emit(Vertex const (&)[12], Sink &)
+      { }
+    };
+
+    template <typename Triangle, typename Make, typename Sink>
+    struct case_emitters
+    {
+      using vertex_t = typename Triangle::vertex_t;
+      using emitter_t = void (*)(Make const &, Sink &);
+
+      template <size_t C>
+      static void emit(Make const &make, Sink &sink)
+      {
+        vertex_t verts[12];
+        edge_vertex<C, 0>::fill(verts, make);
+        edge_vertex<C, 1>::fill(verts, make);
+        edge_vertex<C, 2>::fill(verts, make);
+        edge_vertex<C, 3>::fill(verts, make);
+        edge_vertex<C, 4>::fill(verts, make);
+        edge_vertex<C, 5>::fill(verts, make);
+        edge_vertex<C, 6>::fill(verts, make);
+        edge_vertex<C, 7>::fill(verts, make);
+        edge_vertex<C, 8>::fill(verts, make);
+        edge_vertex<C, 9>::fill(verts, make);
+        edge_vertex<C, 10>::fill(verts, make);
+        edge_vertex<C, 11>::fill(verts, make);
+        case_triangles<C, 0>::template emit<Triangle>(verts, sink);
+      }
+
+      template <size_t... Cs>
+      static emitter_t get(size_t const cube_index, indices<Cs...> const)
+      {
+        static emitter_t const emitters[]{ &emit<Cs>... };
+        return emitters[cube_index];
+      }
+    };
+  }
+
+  /* As polygonize_tables, but jumps straight to the case's emitter;
+   * there are no loops or per-edge tests left to run. */
+  template <typename Triangle, typename Make, typename Sink>
+  void polygonize_cases(int32_t const cube_index, Make const &make, Sink &sink)
+  {
+    using emitters_t = detail::case_emitters<Triangle, Make, Sink>;
+    emitters_t::get(cube_index, typename detail::make_indices<256>::type{})(make, sink);
+  }
+}
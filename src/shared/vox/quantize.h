@@ -0,0 +1,102 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/quantize.h
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    Packs extracted vertices into vertex_q: positions as
+    16 bit steps from a surface's origin and normals as
+    two 8 bit octahedral coordinates. That's a third of
+    a float position, normal, colour and uv; colours and
+    uvs are left for the shader to derive from position.
+    Done once a surface is final, as simplifying and
+    welding want float positions.
+*/
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+
+#include "vec3.h"
+#include "vertex.h"
+#include "region.h"
+
+namespace vox
+{
+  namespace quantize
+  {
+    /* The finest power of two step, of at most 1/32 of a voxel,
+     * which spans extent voxels in 16 bits. */
+    inline float step_for(float const extent)
+    {
+      float step{ 1.0f / 32.0f };
+      while(extent / step > 32767.0f)
+      { step *= 2.0f; }
+      return step;
+    }
+
+    /* Steps for every vertex of a surface over reg, from its lower corner. */
+    inline float step_for(region const &reg)
+    {
+      return step_for(static_cast<float>(std::max({ reg.get_width(), reg.get_height(),
+                                                    reg.get_depth() })));
+    }
+
+    /* Folds the unit octahedron's lower half over its upper, then
+     * maps [-1, 1] onto [0, 255]. */
+    inline void encode_normal(vec3<float> const &n, uint8_t &u, uint8_t &v)
+    {
+      float const l1{ std::abs(n.x) + std::abs(n.y) + std::abs(n.z) };
+      float x{ l1 > 0.0f ? n.x / l1 : 0.0f }, y{ l1 > 0.0f ? n.y / l1 : 0.0f };
+      if(n.z < 0.0f)
+      {
+        float const fx{ (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f) };
+        float const fy{ (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f) };
+        x = fx;
+        y = fy;
+      }
+      u = static_cast<uint8_t>(std::floor((x * 0.5f + 0.5f) * 255.0f + 0.5f));
+      v = static_cast<uint8_t>(std::floor((y * 0.5f + 0.5f) * 255.0f + 0.5f));
+    }
+
+    /* The inverse of encode_normal(), as the shaders do it. */
+    inline vec3<float> decode_normal(uint8_t const u, uint8_t const v)
+    {
+      float x{ u / 127.5f - 1.0f }, y{ v / 127.5f - 1.0f };
+      float const z{ 1.0f - std::abs(x) - std::abs(y) };
+      float const t{ std::max(-z, 0.0f) };
+      x += x >= 0.0f ? -t : t;
+      y += y >= 0.0f ? -t : t;
+      float const length{ std::sqrt(x * x + y * y + z * z) };
+      return { x / length, y / length, z / length };
+    }
+
+    inline int16_t encode_position(float const p, float const origin, float const step)
+    {
+      float const q{ std::floor((p - origin) / step + 0.5f) };
+      return static_cast<int16_t>(std::min(std::max(q, -32767.0f), 32767.0f));
+    }
+
+    /* out[i] = in[i], relative to origin in steps of step. */
+    inline void pack(vertex_pn const *in, size_t const count, vec3<float> const &origin,
+                     float const step, vertex_q *out)
+    {
+      for(size_t i{}; i < count; ++i)
+      {
+        auto &q(out[i]);
+        q.p[0] = encode_position(in[i].p.x, origin.x, step);
+        q.p[1] = encode_position(in[i].p.y, origin.y, step);
+        q.p[2] = encode_position(in[i].p.z, origin.z, step);
+        q.p[3] = 1;
+        encode_normal(in[i].n, q.n[0], q.n[1]);
+        q.n[2] = 0;
+        q.n[3] = 255;
+      }
+    }
+  }
+}
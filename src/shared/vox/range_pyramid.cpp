@@ -0,0 +1,38 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/range_pyramid.cpp
+  Author: Jesse 'Jeaye' Wilkerson
+*/
+
+#include "range_pyramid.h"
+
+/* SSE2 is always there on x86-64. */
+#if defined(__x86_64__) && defined(__GNUC__)
+  #define VOX_RANGES_SSE2
+  #include <emmintrin.h>
+#endif
+
+namespace vox
+{
+  namespace ranges
+  {
+    void fold(uint8_t const *run, size_t const count, uint8_t *low, uint8_t *high)
+    {
+      size_t i{};
+#ifdef VOX_RANGES_SSE2
+      for(; i + 16 <= count; i += 16)
+      {
+        __m128i const v(_mm_loadu_si128(reinterpret_cast<__m128i const*>(run + i)));
+        __m128i * const l(reinterpret_cast<__m128i*>(low + i));
+        __m128i * const h(reinterpret_cast<__m128i*>(high + i));
+        _mm_storeu_si128(l, _mm_min_epu8(_mm_loadu_si128(l), v));
+        _mm_storeu_si128(h, _mm_max_epu8(_mm_loadu_si128(h), v));
+      }
+#endif
+      fold<uint8_t>(run + i, count - i, low + i, high + i);
+    }
+  }
+}
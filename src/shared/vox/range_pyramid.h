@@ -0,0 +1,345 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/range_pyramid.h
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    Min/max values over cubic blocks of a volume, with
+    coarser levels built on top; each level's blocks are
+    twice as wide as the last's. Answers range queries
+    over arbitrary boxes of voxels without touching them.
+    Volumes with z runs are scanned a run at a time, which
+    is vectorized for uint8_t.
+*/
+
+#pragma once
+
+#include <vector>
+#include <future>
+#include <algorithm>
+#include <type_traits>
+#include <cstdint>
+
+#include "region.h"
+#include "layout.h"
+#include "util/thread_pool.h"
+
+namespace vox
+{
+  namespace ranges
+  {
+    /* low[i] = min(low[i], run[i]), high[i] = max(high[i], run[i]) */
+    void fold(uint8_t const *run, size_t const count, uint8_t *low, uint8_t *high);
+    template <typename Value>
+    void fold(Value const *run, size_t const count, Value *low, Value *high)
+    {
+      for(size_t i{}; i < count; ++i)
+      {
+        low[i] = std::min(low[i], run[i]);
+        high[i] = std::max(high[i], run[i]);
+      }
+    }
+  }
+
+  /* Whether a volume hands out contiguous runs along z. */
+  template <typename Volume, typename Enable = void>
+  struct has_z_runs : std::false_type
+  { };
+  template <typename Volume>
+  struct has_z_runs<Volume, typename std::enable_if<std::is_same<typename Volume::layout_t,
+                                                                 layout::xyz>::value>::type>
+    : std::true_type
+  { };
+
+  template <typename Value, size_t BlockSize = 8>
+  class range_pyramid
+  {
+    static_assert(BlockSize && !(BlockSize & (BlockSize - 1)),
+                  "Block size must be a power of two");
+
+    public:
+      using value_t = Value;
+      static size_t constexpr const block_size{ BlockSize };
+
+      struct range
+      { value_t min, max; };
+
+      range_pyramid(size_t const width, size_t const height, size_t const depth,
+                    value_t const value = value_t{})
+      {
+        size_t size{ block_size };
+        do
+        {
+          m_levels.emplace_back(level{ blocks_along(width, size),
+                                       blocks_along(height, size),
+                                       blocks_along(depth, size) });
+          auto &l(m_levels.back());
+          l.ranges.assign(l.width * l.height * l.depth, range{ value, value });
+          size <<= 1;
+        } while(m_levels.back().ranges.size() > 1);
+      }
+
+      /* Scans every voxel; the base level's x-slabs are spread
+       * across the pool. */
+      template <typename Volume>
+      void build(Volume const &vol, util::thread_pool &pool)
+      {
+        auto &base(m_levels.front());
+        std::vector<std::future<void>> futs;
+        futs.reserve(base.width);
+        for(size_t bx{}; bx < base.width; ++bx)
+        {
+          futs.push_back(pool.submit([this, &vol, bx]
+          { scan_slab(vol, bx, has_z_runs<Volume>{}); }));
+        }
+        for(auto &f : futs)
+        { f.get(); }
+
+        for(size_t l{ 1 }; l < m_levels.size(); ++l)
+        {
+          auto const &next(m_levels[l]);
+          for(size_t bx{}; bx < next.width; ++bx)
+          {
+            for(size_t by{}; by < next.height; ++by)
+            {
+              for(size_t bz{}; bz < next.depth; ++bz)
+              { reduce(l, bx, by, bz); }
+            }
+          }
+        }
+      }
+
+      /* Exactly recomputes the blocks overlapping a box of voxels,
+       * and their ancestors; use after writes which bypassed widen(). */
+      template <typename Volume>
+      void rebuild(Volume const &vol, region const &voxels)
+      {
+        size_t lower_x(std::max(voxels.lower_corner.x, 0) / block_size);
+        size_t lower_y(std::max(voxels.lower_corner.y, 0) / block_size);
+        size_t lower_z(std::max(voxels.lower_corner.z, 0) / block_size);
+        size_t upper_x(blocks_along(std::max(voxels.upper_corner.x, 0), block_size));
+        size_t upper_y(blocks_along(std::max(voxels.upper_corner.y, 0), block_size));
+        size_t upper_z(blocks_along(std::max(voxels.upper_corner.z, 0), block_size));
+
+        for(size_t l{}; l < m_levels.size(); ++l)
+        {
+          auto const &lev(m_levels[l]);
+          upper_x = std::min(upper_x, lev.width);
+          upper_y = std::min(upper_y, lev.height);
+          upper_z = std::min(upper_z, lev.depth);
+          for(size_t bx{ lower_x }; bx < upper_x; ++bx)
+          {
+            for(size_t by{ lower_y }; by < upper_y; ++by)
+            {
+              for(size_t bz{ lower_z }; bz < upper_z; ++bz)
+              {
+                if(l == 0)
+                { scan(vol, bx, by, bz); }
+                else
+                { reduce(l, bx, by, bz); }
+              }
+            }
+          }
+
+          lower_x >>= 1; lower_y >>= 1; lower_z >>= 1;
+          upper_x = (upper_x + 1) >> 1;
+          upper_y = (upper_y + 1) >> 1;
+          upper_z = (upper_z + 1) >> 1;
+        }
+      }
+
+      /* Accounts for a single write. Ranges only ever grow here,
+       * so they stay conservative (never wrong, maybe loose)
+       * until the next rebuild. */
+      void widen(size_t const x, size_t const y, size_t const z, value_t const value)
+      {
+        size_t bx{ x / block_size }, by{ y / block_size }, bz{ z / block_size };
+        for(auto &lev : m_levels)
+        {
+          auto &r(lev.ranges[lev.index(bx, by, bz)]);
+          if(!(value < r.min) && !(r.max < value))
+          { break; }
+          r.min = std::min(r.min, value);
+          r.max = std::max(r.max, value);
+          bx >>= 1; by >>= 1; bz >>= 1;
+        }
+      }
+
+      /* A range covering every voxel in the box; it may be wider
+       * than the box's true range, but never narrower. */
+      bool get_range(region const &voxels, value_t &min, value_t &max) const
+      {
+        bool found{ false };
+        visit(m_levels.size() - 1, 0, 0, 0, voxels, min, max, found);
+        return found;
+      }
+
+      size_t get_level_count() const
+      { return m_levels.size(); }
+
+    private:
+      struct level
+      {
+        size_t index(size_t const bx, size_t const by, size_t const bz) const
+        { return ((bx * height) + by) * depth + bz; }
+
+        size_t width, height, depth;
+        std::vector<range> ranges;
+      };
+
+      static size_t blocks_along(size_t const length, size_t const size)
+      { return std::max<size_t>(1, (length + size - 1) / size); }
+
+      template <typename Volume>
+      void scan_slab(Volume const &vol, size_t const bx, std::false_type const)
+      {
+        auto const &base(m_levels.front());
+        for(size_t by{}; by < base.height; ++by)
+        {
+          for(size_t bz{}; bz < base.depth; ++bz)
+          { scan(vol, bx, by, bz); }
+        }
+      }
+
+      /* Folds the z runs of each row of blocks together element by
+       * element, which streams through memory, then splits the
+       * folded run into blocks. */
+      template <typename Volume>
+      void scan_slab(Volume const &vol, size_t const bx, std::true_type const)
+      {
+        auto const &reg(vol.get_region());
+        size_t const width(reg.get_width()), height(reg.get_height()), depth(reg.get_depth());
+        size_t const lower_x{ bx * block_size };
+        size_t const upper_x{ std::min(lower_x + block_size, width) };
+        if(lower_x >= upper_x || height == 0 || depth == 0)
+        { return; }
+
+        auto &base(m_levels.front());
+        std::vector<value_t> low(depth), high(depth);
+        for(size_t by{}; by < base.height; ++by)
+        {
+          size_t const lower_y{ by * block_size };
+          size_t const upper_y{ std::min(lower_y + block_size, height) };
+          if(lower_y >= upper_y)
+          { continue; }
+
+          value_t * const lows(low.data());
+          value_t * const highs(high.data());
+          auto const first(vol.run(lower_x, lower_y));
+          std::copy(first.begin(), first.end(), lows);
+          std::copy(first.begin(), first.end(), highs);
+          for(size_t x{ lower_x }; x < upper_x; ++x)
+          {
+            for(size_t y{ lower_y }; y < upper_y; ++y)
+            { ranges::fold(vol.run(x, y).data(), depth, lows, highs); }
+          }
+
+          for(size_t bz{}; bz < base.depth; ++bz)
+          {
+            size_t const lower_z{ bz * block_size };
+            size_t const upper_z{ std::min(lower_z + block_size, depth) };
+            if(lower_z >= upper_z)
+            { continue; }
+
+            auto &r(base.ranges[base.index(bx, by, bz)]);
+            r.min = *std::min_element(lows + lower_z, lows + upper_z);
+            r.max = *std::max_element(highs + lower_z, highs + upper_z);
+          }
+        }
+      }
+
+      template <typename Volume>
+      void scan(Volume const &vol, size_t const bx, size_t const by, size_t const bz)
+      {
+        auto const &reg(vol.get_region());
+        size_t const lower_x{ bx * block_size }, lower_y{ by * block_size }, lower_z{ bz * block_size };
+        size_t const upper_x{ std::min<size_t>(lower_x + block_size, reg.get_width()) };
+        size_t const upper_y{ std::min<size_t>(lower_y + block_size, reg.get_height()) };
+        size_t const upper_z{ std::min<size_t>(lower_z + block_size, reg.get_depth()) };
+
+        auto &base(m_levels.front());
+        auto &r(base.ranges[base.index(bx, by, bz)]);
+        if(lower_x >= upper_x || lower_y >= upper_y || lower_z >= upper_z)
+        { return; }
+
+        /* Kept in locals; voxels may alias the range's storage. */
+        value_t min(vol(lower_x, lower_y, lower_z)), max(min);
+        for(size_t x{ lower_x }; x < upper_x; ++x)
+        {
+          for(size_t y{ lower_y }; y < upper_y; ++y)
+          {
+            for(size_t z{ lower_z }; z < upper_z; ++z)
+            {
+              value_t const v(vol(x, y, z));
+              min = std::min(min, v);
+              max = std::max(max, v);
+            }
+          }
+        }
+        r.min = min;
+        r.max = max;
+      }
+
+      void reduce(size_t const l, size_t const bx, size_t const by, size_t const bz)
+      {
+        auto const &prev(m_levels[l - 1]);
+        auto &lev(m_levels[l]);
+        auto &r(lev.ranges[lev.index(bx, by, bz)]);
+        r = prev.ranges[prev.index(bx * 2, by * 2, bz * 2)];
+        for(size_t x{ bx * 2 }; x < std::min(bx * 2 + 2, prev.width); ++x)
+        {
+          for(size_t y{ by * 2 }; y < std::min(by * 2 + 2, prev.height); ++y)
+          {
+            for(size_t z{ bz * 2 }; z < std::min(bz * 2 + 2, prev.depth); ++z)
+            {
+              auto const &child(prev.ranges[prev.index(x, y, z)]);
+              r.min = std::min(r.min, child.min);
+              r.max = std::max(r.max, child.max);
+            }
+          }
+        }
+      }
+
+      /* Descends only into blocks which partially overlap the box;
+       * blocks within it, and base blocks, are taken whole. */
+      void visit(size_t const l, size_t const bx, size_t const by, size_t const bz,
+                 region const &voxels, value_t &min, value_t &max, bool &found) const
+      {
+        auto const &lev(m_levels[l]);
+        if(bx >= lev.width || by >= lev.height || bz >= lev.depth)
+        { return; }
+
+        region::value_t const size(block_size << l);
+        region::value_t const lower_x(bx * size), lower_y(by * size), lower_z(bz * size);
+        if(lower_x >= voxels.upper_corner.x || lower_x + size <= voxels.lower_corner.x ||
+           lower_y >= voxels.upper_corner.y || lower_y + size <= voxels.lower_corner.y ||
+           lower_z >= voxels.upper_corner.z || lower_z + size <= voxels.lower_corner.z)
+        { return; }
+
+        bool const inside{ lower_x >= voxels.lower_corner.x && lower_x + size <= voxels.upper_corner.x &&
+                           lower_y >= voxels.lower_corner.y && lower_y + size <= voxels.upper_corner.y &&
+                           lower_z >= voxels.lower_corner.z && lower_z + size <= voxels.upper_corner.z };
+        if(inside || l == 0)
+        {
+          auto const &r(lev.ranges[lev.index(bx, by, bz)]);
+          min = found ? std::min(min, r.min) : r.min;
+          max = found ? std::max(max, r.max) : r.max;
+          found = true;
+          return;
+        }
+
+        for(size_t x{}; x < 2; ++x)
+        {
+          for(size_t y{}; y < 2; ++y)
+          {
+            for(size_t z{}; z < 2; ++z)
+            { visit(l - 1, bx * 2 + x, by * 2 + y, bz * 2 + z, voxels, min, max, found); }
+          }
+        }
+      }
+
+      std::vector<level> m_levels;
+  };
+}
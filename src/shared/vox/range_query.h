@@ -0,0 +1,47 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/range_query.h
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    Lets the extractors ask a volume for the min/max
+    value within a box of voxels, without sampling it.
+    Volumes opt in by providing:
+
+      bool get_range(region const &, value_t &min, value_t &max) const;
+
+    which returns false when the range isn't cheaply known.
+*/
+
+#pragma once
+
+#include <utility>
+
+#include "region.h"
+
+namespace vox
+{
+  /* Fallback; the volume has no acceleration structure. */
+  template <typename Volume, typename Enable = void>
+  struct range_query
+  {
+    using value_t = typename Volume::value_t;
+
+    static bool get(Volume const &, region const &, value_t &, value_t &)
+    { return false; }
+  };
+
+  template <typename Volume>
+  struct range_query<Volume, decltype(void(std::declval<Volume const&>().get_range(
+                                      std::declval<region const&>(),
+                                      std::declval<typename Volume::value_t&>(),
+                                      std::declval<typename Volume::value_t&>())))>
+  {
+    using value_t = typename Volume::value_t;
+
+    static bool get(Volume const &vol, region const &reg, value_t &min, value_t &max)
+    { return vol.get_range(reg, min, max); }
+  };
+}
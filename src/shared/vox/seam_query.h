@@ -0,0 +1,44 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/seam_query.h
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    Lets the extractors ask a volume where its level of
+    detail changes, so only the cells along those seams
+    need stitching. Volumes opt in by providing:
+
+      bool is_seam(size_t x, size_t y, size_t z, size_t axis) const;
+
+    which is true when the face of the lattice cell with
+    its lowest corner at (x, y, z), facing along axis,
+    lies between two levels. See lod_field.h.
+*/
+
+#pragma once
+
+#include <cstdlib>
+#include <utility>
+
+namespace vox
+{
+  /* Fallback; the volume is the same everywhere. */
+  template <typename Volume, typename Enable = void>
+  struct seam_query
+  {
+    static bool is_seam(Volume const &, size_t const, size_t const,
+                        size_t const, size_t const)
+    { return false; }
+  };
+
+  template <typename Volume>
+  struct seam_query<Volume, decltype(void(std::declval<Volume const&>().is_seam(
+                                     size_t{}, size_t{}, size_t{}, size_t{})))>
+  {
+    static bool is_seam(Volume const &vol, size_t const x, size_t const y,
+                        size_t const z, size_t const axis)
+    { return vol.is_seam(x, y, z, axis); }
+  };
+}
@@ -0,0 +1,438 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/simplifier.h
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    Quadric error edge collapse, after Garland and
+    Heckbert. Each vertex sums the squared distances to
+    the planes of its faces; edges are collapsed cheapest
+    first, so flat areas go long before silhouettes do.
+    Vertices on open edges or outside a given box are
+    locked, which keeps chunk seams intact.
+*/
+
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <limits>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+
+#include "vec3.h"
+#include "vertex.h"
+#include "region.h"
+#include "surface.h"
+#include "indexed_surface.h"
+
+namespace vox
+{
+  template <typename Vertex>
+  class simplifier
+  {
+    public:
+      using vertex_t = Vertex;
+      using indexed_surface_t = indexed_surface<Vertex>;
+      using index_t = typename indexed_surface_t::index_t;
+
+      explicit simplifier(indexed_surface_t const &mesh)
+        : m_vertices(mesh.get_vertices())
+        , m_quadrics(m_vertices.size())
+        , m_faces_of(m_vertices.size())
+        , m_locked(m_vertices.size())
+        , m_removed(m_vertices.size())
+        , m_versions(m_vertices.size())
+      {
+        auto const &indices(mesh.get_indices());
+        m_faces.reserve(indices.size() / 3);
+        for(size_t i{}; i + 2 < indices.size(); i += 3)
+        {
+          face const f{ { indices[i], indices[i + 1], indices[i + 2] }, false };
+          if(f.v[0] == f.v[1] || f.v[1] == f.v[2] || f.v[2] == f.v[0])
+          { continue; }
+          for(auto const v : f.v)
+          { m_faces_of[v].push_back(static_cast<index_t>(m_faces.size())); }
+          m_faces.push_back(f);
+        }
+        m_face_count = m_faces.size();
+
+        /* Open edges belong to one face; nothing there may move. */
+        std::unordered_map<uint64_t, uint32_t> uses;
+        for(auto const &f : m_faces)
+        {
+          add_plane(f);
+          for(size_t e{}; e < 3; ++e)
+          { ++uses[edge_key(f.v[e], f.v[(e + 1) % 3])]; }
+        }
+        for(auto const &use : uses)
+        {
+          if(use.second == 1)
+          {
+            m_locked[static_cast<index_t>(use.first >> 32)] = true;
+            m_locked[static_cast<index_t>(use.first)] = true;
+          }
+        }
+      }
+
+      /* Joins a triangle soup's vertices which fall within quantum of
+       * each other; extractor output repeats every shared vertex. */
+      template <typename Triangle>
+      static indexed_surface_t weld(surface<Triangle> const &soup, float const quantum)
+      {
+        indexed_surface_t mesh(soup.get_region());
+        std::unordered_map<uint64_t, index_t> seen;
+        seen.reserve(soup.get_triangles().size() * 2);
+        for(auto const &tri : soup.get_triangles())
+        {
+          index_t ids[3];
+          for(size_t k{}; k < 3; ++k)
+          {
+            auto const &p(tri.verts[k].p);
+            auto const snap([quantum](float const c)
+            { return static_cast<uint64_t>(static_cast<int64_t>(std::floor(c / quantum + 0.5f)) & 0x1fffff); });
+            uint64_t const key{ (snap(p.x) << 42) | (snap(p.y) << 21) | snap(p.z) };
+            auto const found(seen.find(key));
+            if(found != seen.end())
+            { ids[k] = found->second; }
+            else
+            { ids[k] = seen[key] = mesh.add_vertex(tri.verts[k]); }
+          }
+          if(ids[0] != ids[1] && ids[1] != ids[2] && ids[2] != ids[0])
+          { mesh.add_triangle(ids[0], ids[1], ids[2]); }
+        }
+        return mesh;
+      }
+
+      /* Locks every vertex which isn't strictly inside the box. */
+      void lock_outside(vec3<float> const &lower, vec3<float> const &upper)
+      {
+        for(size_t v{}; v < m_vertices.size(); ++v)
+        {
+          auto const &p(m_vertices[v].p);
+          if(!(p.x > lower.x && p.y > lower.y && p.z > lower.z &&
+               p.x < upper.x && p.y < upper.y && p.z < upper.z))
+          { m_locked[v] = true; }
+        }
+      }
+
+      /* Collapses edges, cheapest first, until at most target
+       * triangles are left or the cheapest collapse would cost more
+       * than max_error, a sum of squared distances. Returns the number
+       * of triangles left. */
+      size_t simplify(size_t const target, float const max_error)
+      {
+        std::unordered_set<uint64_t> queued;
+        for(auto const &f : m_faces)
+        {
+          for(size_t e{}; e < 3; ++e)
+          {
+            if(queued.insert(edge_key(f.v[e], f.v[(e + 1) % 3])).second)
+            { push(f.v[e], f.v[(e + 1) % 3]); }
+          }
+        }
+
+        while(m_face_count > target && !m_heap.empty())
+        {
+          auto const top(m_heap.top());
+          m_heap.pop();
+          if(top.cost > max_error)
+          { break; }
+          if(m_removed[top.keep] || m_removed[top.drop] ||
+             m_versions[top.keep] != top.keep_version ||
+             m_versions[top.drop] != top.drop_version)
+          { continue; }
+          if(!can_collapse(top))
+          { continue; }
+          collapse(top);
+        }
+        return m_face_count;
+      }
+
+      /* The simplified mesh, without the removed vertices. */
+      indexed_surface_t get_surface(region const &reg) const
+      {
+        indexed_surface_t mesh(reg);
+        std::vector<index_t> remap(m_vertices.size(), std::numeric_limits<index_t>::max());
+        for(auto const &f : m_faces)
+        {
+          if(f.removed)
+          { continue; }
+          index_t ids[3];
+          for(size_t k{}; k < 3; ++k)
+          {
+            auto &id(remap[f.v[k]]);
+            if(id == std::numeric_limits<index_t>::max())
+            { id = mesh.add_vertex(m_vertices[f.v[k]]); }
+            ids[k] = id;
+          }
+          mesh.add_triangle(ids[0], ids[1], ids[2]);
+        }
+        return mesh;
+      }
+
+      /* The simplified mesh, as a triangle soup. */
+      template <typename Triangle>
+      void get_triangles(surface<Triangle> &soup) const
+      {
+        soup.clear();
+        soup.reserve(m_face_count);
+        for(auto const &f : m_faces)
+        {
+          if(!f.removed)
+          { soup.add_triangle(Triangle(m_vertices[f.v[0]], m_vertices[f.v[1]], m_vertices[f.v[2]])); }
+        }
+      }
+
+    private:
+      struct face
+      {
+        index_t v[3];
+        bool removed;
+      };
+
+      /* A symmetric 4x4 matrix; only the upper triangle is kept. */
+      struct quadric
+      {
+        void add(quadric const &q)
+        {
+          for(size_t i{}; i < 10; ++i)
+          { m[i] += q.m[i]; }
+        }
+        double error(vec3<float> const &p) const
+        {
+          double const x{ p.x }, y{ p.y }, z{ p.z };
+          return m[0] * x * x + 2 * m[1] * x * y + 2 * m[2] * x * z + 2 * m[3] * x +
+                 m[4] * y * y + 2 * m[5] * y * z + 2 * m[6] * y +
+                 m[7] * z * z + 2 * m[8] * z + m[9];
+        }
+
+        double m[10]{};
+      };
+
+      struct candidate
+      {
+        float cost;
+        index_t keep, drop;
+        uint32_t keep_version, drop_version;
+        vec3<float> target;
+        /* How much of drop's attributes the merged vertex takes. */
+        float blend;
+
+        bool operator >(candidate const &c) const
+        { return cost > c.cost; }
+      };
+
+      static uint64_t edge_key(index_t const a, index_t const b)
+      {
+        return (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+      }
+
+      static vec3<float> face_normal(vec3<float> const &a, vec3<float> const &b,
+                                     vec3<float> const &c)
+      {
+        vec3<float> const u{ b.x - a.x, b.y - a.y, b.z - a.z };
+        vec3<float> const v{ c.x - a.x, c.y - a.y, c.z - a.z };
+        return { u.y * v.z - u.z * v.y, u.z * v.x - u.x * v.z, u.x * v.y - u.y * v.x };
+      }
+
+      void add_plane(face const &f)
+      {
+        auto const &a(m_vertices[f.v[0]].p);
+        auto n(face_normal(a, m_vertices[f.v[1]].p, m_vertices[f.v[2]].p));
+        double const length{ std::sqrt(double(n.x) * n.x + double(n.y) * n.y + double(n.z) * n.z) };
+        if(length <= 0.0)
+        { return; }
+
+        double const nx{ n.x / length }, ny{ n.y / length }, nz{ n.z / length };
+        double const d{ -(nx * a.x + ny * a.y + nz * a.z) };
+        quadric q;
+        q.m[0] = nx * nx; q.m[1] = nx * ny; q.m[2] = nx * nz; q.m[3] = nx * d;
+        q.m[4] = ny * ny; q.m[5] = ny * nz; q.m[6] = ny * d;
+        q.m[7] = nz * nz; q.m[8] = nz * d;
+        q.m[9] = d * d;
+        for(auto const v : f.v)
+        { m_quadrics[v].add(q); }
+      }
+
+      /* Queues the cheapest way of collapsing the edge, if any. */
+      void push(index_t const a, index_t const b)
+      {
+        if(m_locked[a] && m_locked[b])
+        { return; }
+
+        quadric q(m_quadrics[a]);
+        q.add(m_quadrics[b]);
+        auto const &pa(m_vertices[a].p), &pb(m_vertices[b].p);
+
+        candidate best;
+        if(m_locked[a] || m_locked[b])
+        {
+          best.keep = m_locked[a] ? a : b;
+          best.drop = m_locked[a] ? b : a;
+          best.target = m_vertices[best.keep].p;
+          best.blend = 0.0f;
+          best.cost = static_cast<float>(q.error(best.target));
+        }
+        else
+        {
+          vec3<float> const mid{ (pa.x + pb.x) * 0.5f, (pa.y + pb.y) * 0.5f, (pa.z + pb.z) * 0.5f };
+          double const ea{ q.error(pa) }, eb{ q.error(pb) }, em{ q.error(mid) };
+          best.keep = a;
+          best.drop = b;
+          if(ea <= eb && ea <= em)
+          { best.target = pa; best.blend = 0.0f; best.cost = static_cast<float>(ea); }
+          else if(eb <= em)
+          { best.target = pb; best.blend = 1.0f; best.cost = static_cast<float>(eb); }
+          else
+          { best.target = mid; best.blend = 0.5f; best.cost = static_cast<float>(em); }
+        }
+        best.cost = std::max(best.cost, 0.0f);
+        best.keep_version = m_versions[best.keep];
+        best.drop_version = m_versions[best.drop];
+        m_heap.push(best);
+      }
+
+      /* Adds the vertices sharing a live face with v to out. */
+      void neighbours(index_t const v, std::vector<index_t> &out) const
+      {
+        out.clear();
+        for(auto const fi : m_faces_of[v])
+        {
+          auto const &f(m_faces[fi]);
+          if(f.removed)
+          { continue; }
+          for(auto const w : f.v)
+          {
+            if(w != v && std::find(out.begin(), out.end(), w) == out.end())
+            { out.push_back(w); }
+          }
+        }
+      }
+
+      /* Rejects collapses which would fold a face over or pinch the
+       * mesh into something non-manifold. */
+      bool can_collapse(candidate const &c)
+      {
+        /* The vertices around both ends must be exactly those
+         * opposite the edge, or the collapse joins two sheets. */
+        neighbours(c.keep, m_scratch_keep);
+        neighbours(c.drop, m_scratch_drop);
+        size_t shared{}, opposite{};
+        for(auto const w : m_scratch_keep)
+        {
+          if(std::find(m_scratch_drop.begin(), m_scratch_drop.end(), w) != m_scratch_drop.end())
+          { ++shared; }
+        }
+        for(auto const fi : m_faces_of[c.keep])
+        {
+          auto const &f(m_faces[fi]);
+          if(!f.removed && (f.v[0] == c.drop || f.v[1] == c.drop || f.v[2] == c.drop))
+          { ++opposite; }
+        }
+        if(shared != opposite)
+        { return false; }
+
+        return keeps_orientation(c.keep, c) && keeps_orientation(c.drop, c);
+      }
+
+      /* Whether v's faces which survive the collapse still face the
+       * same way once v is moved to the target. */
+      bool keeps_orientation(index_t const v, candidate const &c) const
+      {
+        for(auto const fi : m_faces_of[v])
+        {
+          auto const &f(m_faces[fi]);
+          if(f.removed)
+          { continue; }
+          bool const has_keep{ f.v[0] == c.keep || f.v[1] == c.keep || f.v[2] == c.keep };
+          bool const has_drop{ f.v[0] == c.drop || f.v[1] == c.drop || f.v[2] == c.drop };
+          if(has_keep && has_drop)
+          { continue; }
+
+          vec3<float> moved[3];
+          for(size_t k{}; k < 3; ++k)
+          { moved[k] = (f.v[k] == v) ? c.target : m_vertices[f.v[k]].p; }
+          auto const before(face_normal(m_vertices[f.v[0]].p, m_vertices[f.v[1]].p,
+                                        m_vertices[f.v[2]].p));
+          auto const after(face_normal(moved[0], moved[1], moved[2]));
+          float const dot{ before.x * after.x + before.y * after.y + before.z * after.z };
+          float const area{ after.x * after.x + after.y * after.y + after.z * after.z };
+          if(dot <= 0.0f || area <= 0.0f)
+          { return false; }
+        }
+        return true;
+      }
+
+      void collapse(candidate const &c)
+      {
+        auto &kept(m_vertices[c.keep]);
+        blend(kept, m_vertices[c.drop], c.blend, has_normal<vertex_t>{});
+        kept.p = c.target;
+        m_quadrics[c.keep].add(m_quadrics[c.drop]);
+        m_removed[c.drop] = true;
+        ++m_versions[c.keep];
+        ++m_versions[c.drop];
+
+        for(auto const fi : m_faces_of[c.drop])
+        {
+          auto &f(m_faces[fi]);
+          if(f.removed)
+          { continue; }
+          if(f.v[0] == c.keep || f.v[1] == c.keep || f.v[2] == c.keep)
+          {
+            f.removed = true;
+            --m_face_count;
+            continue;
+          }
+          for(auto &v : f.v)
+          {
+            if(v == c.drop)
+            { v = c.keep; }
+          }
+          m_faces_of[c.keep].push_back(fi);
+        }
+        m_faces_of[c.drop].clear();
+
+        auto &faces(m_faces_of[c.keep]);
+        faces.erase(std::remove_if(faces.begin(), faces.end(),
+                    [this](index_t const fi){ return m_faces[fi].removed; }), faces.end());
+
+        neighbours(c.keep, m_scratch_keep);
+        for(auto const w : m_scratch_keep)
+        { push(c.keep, w); }
+      }
+
+      void blend(vertex_t &, vertex_t const &, float const, std::false_type const) const
+      { }
+      void blend(vertex_t &kept, vertex_t const &dropped, float const t, std::true_type const) const
+      {
+        vec3<float> const n
+        {
+          kept.n.x + t * (dropped.n.x - kept.n.x),
+          kept.n.y + t * (dropped.n.y - kept.n.y),
+          kept.n.z + t * (dropped.n.z - kept.n.z)
+        };
+        float const length{ std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z) };
+        if(length > 0.0f)
+        { kept.n = { n.x / length, n.y / length, n.z / length }; }
+      }
+
+      std::vector<vertex_t> m_vertices;
+      std::vector<quadric> m_quadrics;
+      std::vector<face> m_faces;
+      std::vector<std::vector<index_t>> m_faces_of;
+      std::vector<bool> m_locked, m_removed;
+      std::vector<uint32_t> m_versions;
+      std::priority_queue<candidate, std::vector<candidate>, std::greater<candidate>> m_heap;
+      std::vector<index_t> m_scratch_keep, m_scratch_drop;
+      size_t m_face_count{};
+  };
+}
@@ -0,0 +1,130 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/soa_surface.h
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    A surface kept as structure of arrays: a run of floats
+    per triangle corner and axis, rather than a vector of
+    triangles. Only positions are kept, plus face normals
+    once calculate_normals() has been run; that pass, and
+    anything else wanting whole lanes of triangles, reads
+    the runs as they are. Extractors fill one through a
+    sink, as with surface.
+*/
+
+#pragma once
+
+#include <vector>
+#include <cstdlib>
+
+#include "region.h"
+#include "vec3.h"
+#include "normals.h"
+
+namespace vox
+{
+  template <typename Triangle>
+  class soa_surface
+  {
+    public:
+      using triangle_t = Triangle;
+      using vertex_t = typename Triangle::vertex_t;
+
+      explicit soa_surface(region const &reg)
+        : m_region(reg)
+      { }
+
+      void add_triangle(Triangle const &tri)
+      {
+        for(size_t c{}; c < 3; ++c)
+        {
+          m_x[c].push_back(tri.verts[c].p.x);
+          m_y[c].push_back(tri.verts[c].p.y);
+          m_z[c].push_back(tri.verts[c].p.z);
+        }
+      }
+      template <typename It>
+      void add_triangles(It begin, It const end)
+      {
+        for(; begin != end; ++begin)
+        { add_triangle(*begin); }
+      }
+
+      /* Works out every face normal in one pass. */
+      void calculate_normals()
+      {
+        m_nx.resize(size());
+        m_ny.resize(size());
+        m_nz.resize(size());
+        normals::face(get_corners(), size(), m_nx.data(), m_ny.data(), m_nz.data());
+      }
+
+      /* Drops the triangles but keeps the storage for reuse. */
+      void clear()
+      {
+        for(size_t c{}; c < 3; ++c)
+        {
+          m_x[c].clear();
+          m_y[c].clear();
+          m_z[c].clear();
+        }
+        m_nx.clear();
+        m_ny.clear();
+        m_nz.clear();
+      }
+      void reserve(size_t const count)
+      {
+        for(size_t c{}; c < 3; ++c)
+        {
+          m_x[c].reserve(count);
+          m_y[c].reserve(count);
+          m_z[c].reserve(count);
+        }
+      }
+
+      size_t size() const
+      { return m_x[0].size(); }
+
+      /* The runs of each corner's positions. */
+      normals::corners get_corners() const
+      {
+        return
+        {
+          { m_x[0].data(), m_x[1].data(), m_x[2].data() },
+          { m_y[0].data(), m_y[1].data(), m_y[2].data() },
+          { m_z[0].data(), m_z[1].data(), m_z[2].data() }
+        };
+      }
+
+      /* Empty until calculate_normals(). */
+      std::vector<float> const& get_normals_x() const
+      { return m_nx; }
+      std::vector<float> const& get_normals_y() const
+      { return m_ny; }
+      std::vector<float> const& get_normals_z() const
+      { return m_nz; }
+
+      vec3<float> get_position(size_t const tri, size_t const corner) const
+      { return { m_x[corner][tri], m_y[corner][tri], m_z[corner][tri] }; }
+      vec3<float> get_normal(size_t const tri) const
+      { return { m_nx[tri], m_ny[tri], m_nz[tri] }; }
+
+      /* Rebuilt from the positions; any normal isn't filled in. */
+      Triangle get_triangle(size_t const tri) const
+      {
+        return { vertex_t{ get_position(tri, 0) }, vertex_t{ get_position(tri, 1) },
+                 vertex_t{ get_position(tri, 2) } };
+      }
+
+      region const& get_region() const
+      { return m_region; }
+
+    private:
+      std::vector<float> m_x[3], m_y[3], m_z[3];
+      std::vector<float> m_nx, m_ny, m_nz;
+      region const m_region;
+  };
+}
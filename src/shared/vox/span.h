@@ -0,0 +1,46 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/span.h
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    A non-owning view over contiguous voxels.
+*/
+
+#pragma once
+
+#include <cstdlib>
+
+namespace vox
+{
+  template <typename Value>
+  class span
+  {
+    public:
+      using value_t = Value;
+
+      span() = default;
+      span(value_t * const data, size_t const size)
+        : m_data(data), m_size(size)
+      { }
+
+      value_t& operator [](size_t const index) const
+      { return m_data[index]; }
+
+      value_t* data() const
+      { return m_data; }
+      size_t size() const
+      { return m_size; }
+
+      value_t* begin() const
+      { return m_data; }
+      value_t* end() const
+      { return m_data + m_size; }
+
+    private:
+      value_t *m_data{ nullptr };
+      size_t m_size{};
+  };
+}
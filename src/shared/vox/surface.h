@@ -12,6 +12,8 @@
 #pragma once
 
 #include <vector>
+#include <iterator>
+#include <utility>
 
 #include "region.h"
 
@@ -32,11 +34,45 @@ namespace vox
         : m_data(std::move(reg.m_data))
         , m_region(std::move(reg.m_region))
       { }
+      /* An empty surface over reg, taking over old's storage. */
+      surface(region const &reg, surface &&old)
+        : m_data(std::move(old.m_data))
+        , m_region(reg)
+      { m_data.clear(); }
       surface<Triangle>& operator =(surface<Triangle> const &) = delete;
 
+      void add_triangle(Triangle const &tri)
+      { m_data.push_back(tri); }
       template <typename It>
       void add_triangles(It begin, It const end)
       { m_data.insert(m_data.end(), begin, end); }
+      void add_triangles(surface &&surf)
+      {
+        /* Steal the storage unless ours is already big enough. */
+        if(m_data.empty() && m_data.capacity() < surf.m_data.size())
+        { m_data = std::move(surf.m_data); }
+        else
+        {
+          m_data.insert(m_data.end(), std::make_move_iterator(surf.m_data.begin()),
+                                      std::make_move_iterator(surf.m_data.end()));
+        }
+      }
+
+      /* Drops the triangles but keeps the storage for reuse. */
+      void clear()
+      { m_data.clear(); }
+      void reserve(size_t const count)
+      { m_data.reserve(count); }
+
+      /* Works out the face normals of every triangle, for those
+       * which have one. The batched, vectorized pass wants the
+       * positions split by axis; see soa_surface.h. */
+      template <typename T = Triangle>
+      auto calculate_normals() -> decltype(void(std::declval<T&>().normal))
+      {
+        for(auto &tri : m_data)
+        { tri.calculate_normal(); }
+      }
 
       std::vector<Triangle> const& get_triangles() const
       { return m_data; }
@@ -12,36 +12,80 @@
 #pragma once
 
 #include <iostream>
+#include <vector>
 #include <cassert>
 #include <limits>
+#include <algorithm>
+#include <type_traits>
+#include <cstdint>
+#include <cmath>
 
 #include "tables.h"
+#include "polygonize.h"
 #include "region.h"
 #include "surface.h"
+#include "soa_surface.h"
+#include "indexed_surface.h"
 #include "grid_cell.h"
+#include "vertex.h"
+#include "range_query.h"
+#include "word_query.h"
+#include "seam_query.h"
+#include "classify.h"
+#include "util/thread_pool.h"
 
 namespace vox
 {
+  /* How each cell is turned into triangles. Tetrahedra give up to
+   * twice the triangles, but their faces agree with the faces of
+   * cells at other unit sizes; see lod_field.h. Transitions are
+   * cubes, but for the cells along the seams the volume reports
+   * (see seam_query.h), which are stitched to agree in the same way. */
+  enum class polygonizer
+  {
+    cubes,
+    tetrahedra,
+    transitions
+  };
+
+  /* Buffers for classifying cells a row at a time; reused across
+   * blocks so the cell loop doesn't allocate. Callers extracting
+   * again and again can keep one and hand it back in. */
+  template <typename Value>
+  struct extractor_scratch
+  {
+    std::vector<Value> values;
+    std::vector<uint8_t> plane, next_plane;
+    std::vector<uint8_t> cubes;
+    std::vector<uint32_t> active;
+  };
+
   template <typename Triangle, typename Volume>
   class surface_extractor
   {
     public:
       using this_t = surface_extractor<Triangle, Volume>;
       using surface_t = surface<Triangle>;
+      using vertex_t = typename Triangle::vertex_t;
+      using indexed_surface_t = indexed_surface<vertex_t>;
       using value_t = typename Volume::value_t;
+      using scratch = extractor_scratch<value_t>;
 
       surface_extractor(Volume const &vol, region const &reg,
-                        value_t const level, size_t const unit)
+                        value_t const level, size_t const unit,
+                        polygonizer const cells = polygonizer::cubes)
         : m_volume(vol)
         , m_region(reg)
         , m_iso_level(level)
         , m_unit_size(unit)
+        , m_polygonizer(cells)
       { validate(); }
       surface_extractor(this_t const &se)
         : m_volume(se.m_volume)
         , m_region(se.m_region)
         , m_iso_level(se.m_iso_level)
         , m_unit_size(se.m_unit_size)
+        , m_polygonizer(se.m_polygonizer)
       { validate(); }
 
       this_t& operator =(this_t const &) = delete;
@@ -52,59 +96,192 @@ namespace vox
       surface_t operator ()() const
       {
         surface_t surface(m_region);
-        std::vector<Triangle> triangles;
+        (*this)(surface);
+        return surface;
+      }
+
+      /* Extracts into an existing surface, replacing its triangles
+       * but keeping its storage; nothing is allocated once the
+       * surface has grown to fit. */
+      void operator ()(surface_t &surface) const
+      {
+        scratch scr;
+        (*this)(surface, scr);
+      }
+      /* The same, reusing scr's buffers as well. */
+      void operator ()(surface_t &surface, scratch &scr) const
+      {
+        surface.clear();
+        auto sink([&surface](Triangle const &tri){ surface.add_triangle(tri); });
+        extract(scr, sink);
+      }
+      /* The same, into the split layout; see soa_surface.h. */
+      void operator ()(soa_surface<Triangle> &surface) const
+      {
+        surface.clear();
+        auto sink([&surface](Triangle const &tri){ surface.add_triangle(tri); });
+        extract(sink);
+      }
+
+      /* Writes every triangle to an output iterator. */
+      template <typename It>
+      It extract_to(It out) const
+      {
+        auto sink([&out](Triangle const &tri){ *out++ = tri; });
+        extract(sink);
+        return out;
+      }
+
+      /* Hands every triangle, in order, to sink(Triangle const&). */
+      template <typename Sink>
+      void extract(Sink &sink) const
+      {
+        scratch scr;
+        extract(scr, sink);
+      }
+      template <typename Sink>
+      void extract(scratch &scr, Sink &sink) const
+      {
+        size_t const width{ get_slab_size() };
+        auto const lower(cell_lower());
+        auto const upper(cell_upper());
+        for(size_t x{ lower.x }; x < upper.x; x += width)
+        { extract_slab(scr, sink, x, width); }
+      }
+
+      /* What one x-slab of the pool path is extracted into. */
+      struct slab
+      {
+        explicit slab(region const &reg)
+          : surface(reg)
+        { }
+
+        surface_t surface;
+        scratch scr;
+      };
+      using slabs_t = std::vector<slab>;
+
+      /* Extracts each x-slab of blocks as its own task on the pool.
+       * Slabs are merged in order, so the output is identical to
+       * the serial extraction's. Keep the slabs alongside the
+       * surface and pass both on every call; they're cleared, not
+       * rebuilt, so nothing is allocated once they've grown to fit. */
+      surface_t operator ()(util::thread_pool &pool) const
+      {
+        surface_t surface(m_region);
+        slabs_t slabs;
+        (*this)(surface, slabs, pool);
+        return surface;
+      }
+      void operator ()(surface_t &surface, util::thread_pool &pool) const
+      {
+        slabs_t slabs;
+        (*this)(surface, slabs, pool);
+      }
+      void operator ()(surface_t &surface, slabs_t &slabs, util::thread_pool &pool) const
+      {
+        size_t const width{ get_slab_size() };
+        auto const lower(cell_lower());
+        auto const upper(cell_upper());
+        size_t const count{ upper.x > lower.x ? (upper.x - lower.x + width - 1) / width : 0 };
+        while(slabs.size() < count)
+        { slabs.emplace_back(m_region); }
+
+        pool.parallel_for(count, 1, [&](size_t const begin, size_t const end)
+        {
+          for(size_t i{ begin }; i < end; ++i)
+          {
+            auto &s(slabs[i]);
+            s.surface.clear();
+            auto sink([&s](Triangle const &tri){ s.surface.add_triangle(tri); });
+            extract_slab(s.scr, sink, lower.x + i * width, width);
+          }
+        });
+
+        size_t total{};
+        for(size_t i{}; i < count; ++i)
+        { total += slabs[i].surface.get_triangles().size(); }
+
+        /* Copied rather than moved, so each slab keeps its storage. */
+        surface.clear();
+        surface.reserve(total);
+        for(size_t i{}; i < count; ++i)
+        {
+          auto const &tris(slabs[i].surface.get_triangles());
+          surface.add_triangles(tris.begin(), tris.end());
+        }
+      }
+
+      /* Extracts an indexed mesh. Every edge crossing is interpolated
+       * once and shared by all of the cells around it; crossings are
+       * cached for the current and the next lattice plane along x.
+       * Cells are always polygonized as cubes here. */
+      indexed_surface_t extract_indexed() const
+      {
+        using index_t = typename indexed_surface_t::index_t;
+        index_t constexpr const invalid{ std::numeric_limits<index_t>::max() };
+
+        indexed_surface_t surface(m_region);
+        size_t const block{ get_block_size() };
+        auto const lower(cell_lower());
+        auto const upper(cell_upper());
+        size_t const points_y{ (upper.y - lower.y + m_unit_size - 1) / m_unit_size + 1 };
+        size_t const points_z{ (upper.z - lower.z + m_unit_size - 1) / m_unit_size + 1 };
+        std::vector<index_t> plane(points_y * points_z * 3, invalid);
+        std::vector<index_t> next_plane(plane.size(), invalid);
         grid_cell<value_t> grid;
+        index_t verts[12];
+        scratch scr;
 
-        for(size_t x{}; x < m_region.get_width() - m_unit_size; x += m_unit_size)
+        for(size_t x{ lower.x }; x < upper.x; x += m_unit_size)
         {
-          for(size_t y{}; y < m_region.get_height() - m_unit_size; y += m_unit_size)
+          for(size_t block_y{ lower.y }; block_y < upper.y; block_y += block)
           {
-            for(size_t z{}; z < m_region.get_depth() - m_unit_size; z += m_unit_size)
+            for(size_t block_z{ lower.z }; block_z < upper.z; block_z += block)
             {
-              grid.p[0].x = x;
-              grid.p[0].y = y;
-              grid.p[0].z = z;
-              grid.val[0] = m_volume[x][y][z];
-
-              grid.p[1].x = x + m_unit_size;
-              grid.p[1].y = y;
-              grid.p[1].z = z; 
-              grid.val[1] = m_volume[x + m_unit_size][y][z];
-
-              grid.p[2].x = x + m_unit_size;
-              grid.p[2].y = y + m_unit_size;
-              grid.p[2].z = z;
-              grid.val[2] = m_volume[x + m_unit_size][y + m_unit_size][z];
-
-              grid.p[3].x = x;
-              grid.p[3].y = y + m_unit_size;
-              grid.p[3].z = z;
-              grid.val[3] = m_volume[x][y + m_unit_size][z];
-
-              grid.p[4].x = x;
-              grid.p[4].y = y;
-              grid.p[4].z = z + m_unit_size;
-              grid.val[4] = m_volume[x][y][z + m_unit_size];
-
-              grid.p[5].x = x + m_unit_size;
-              grid.p[5].y = y;
-              grid.p[5].z = z + m_unit_size;
-              grid.val[5] = m_volume[x + m_unit_size][y][z + m_unit_size];
-
-              grid.p[6].x = x + m_unit_size;
-              grid.p[6].y = y + m_unit_size;
-              grid.p[6].z = z + m_unit_size;
-              grid.val[6] = m_volume[x + m_unit_size][y + m_unit_size][z + m_unit_size];
-
-              grid.p[7].x = x;
-              grid.p[7].y = y + m_unit_size;
-              grid.p[7].z = z + m_unit_size;
-              grid.val[7] = m_volume[x][y + m_unit_size][z + m_unit_size];
-
-              std::vector<Triangle> const tris{ polygonize(grid) };
-              surface.template add_triangles(tris.cbegin(), tris.cend());
+              vec3<size_t> const block_upper
+              { x + m_unit_size, std::min(block_y + block, upper.y),
+                std::min(block_z + block, upper.z) };
+              if(is_empty({ x, block_y, block_z }, block_upper))
+              { continue; }
+
+              for_each_active_cell(scr, { x, block_y, block_z }, block_upper,
+              [&](size_t const, size_t const y, size_t const z, uint8_t const cube_index)
+              {
+                sample_cell(grid, x, y, z);
+                auto const edges(edge_table[cube_index]);
+
+                size_t const point_y{ (y - lower.y) / m_unit_size };
+                size_t const point_z{ (z - lower.z) / m_unit_size };
+                for(size_t e{}; e < 12; ++e)
+                {
+                  if(!(edges & (1 << e)))
+                  { continue; }
+
+                  auto const &owner(edge_owner_table[e]);
+                  auto &cached((owner[0] ? next_plane : plane)
+                               [((point_y + owner[1]) * points_z +
+                                 (point_z + owner[2])) * 3 + owner[3]]);
+                  if(cached == invalid)
+                  {
+                    auto const &corners(edge_corner_table[e]);
+                    cached = surface.add_vertex(make_vertex(grid, corners[0], corners[1]));
+                  }
+                  verts[e] = cached;
+                }
+
+                for(size_t i{}; tri_table[cube_index][i] != -1; i += 3)
+                {
+                  surface.add_triangle(verts[tri_table[cube_index][i]],
+                                       verts[tri_table[cube_index][i + 1]],
+                                       verts[tri_table[cube_index][i + 2]]);
+                }
+              });
             }
           }
+
+          std::swap(plane, next_plane);
+          std::fill(next_plane.begin(), next_plane.end(), invalid);
         }
 
         return surface;
@@ -116,68 +293,706 @@ namespace vox
         assert(m_volume.get_region().contains(m_region));
       }
 
+      /* Cell origins lie on the region's lattice, in [lower, upper). */
+      vec3<size_t> cell_lower() const
+      {
+        return
+        {
+          static_cast<size_t>(m_region.lower_corner.x),
+          static_cast<size_t>(m_region.lower_corner.y),
+          static_cast<size_t>(m_region.lower_corner.z)
+        };
+      }
+      vec3<size_t> cell_upper() const
+      {
+        auto const upper([this](region::value_t const lower, region::value_t const upper)
+        {
+          return static_cast<size_t>(std::max(lower,
+                  upper - static_cast<region::value_t>(m_unit_size)));
+        });
+        return
+        {
+          upper(m_region.lower_corner.x, m_region.upper_corner.x),
+          upper(m_region.lower_corner.y, m_region.upper_corner.y),
+          upper(m_region.lower_corner.z, m_region.upper_corner.z)
+        };
+      }
+
+      /* Blocks are the unit of skipping and classification; they
+       * always span a whole number of cells, and enough of them to
+       * keep classification rows useful. */
+      size_t get_block_size() const
+      {
+        size_t const cells{ m_block_voxels / m_unit_size };
+        return (cells > m_block_cells ? cells : m_block_cells) * m_unit_size;
+      }
+
+      /* Extraction walks x-slabs of about m_block_voxels, but at
+       * least a cell, wide; they're also the unit of parallel work.
+       * Slabs don't take the block's minimum in cells, which only
+       * matters along the rows, so coarse units still spread across
+       * the pool rather than landing in a handful of wide slabs. */
+      size_t get_slab_size() const
+      {
+        size_t const cells{ m_block_voxels / m_unit_size };
+        return (cells > 1 ? cells : 1) * m_unit_size;
+      }
+
+      /* Walks one x-slab, width wide, in blocks of cells, skipping
+       * blocks which the volume knows to be entirely in or out. */
+      template <typename Sink>
+      void extract_slab(scratch &scr, Sink &sink, size_t const x,
+                        size_t const width) const
+      {
+        size_t const block{ get_block_size() };
+        auto const lower(cell_lower());
+        auto const upper(cell_upper());
+        size_t const upper_x{ std::min(x + width, upper.x) };
+        for(size_t y{ lower.y }; y < upper.y; y += block)
+        {
+          for(size_t z{ lower.z }; z < upper.z; z += block)
+          {
+            vec3<size_t> const block_upper
+            { upper_x, std::min(y + block, upper.y), std::min(z + block, upper.z) };
+            if(!is_empty({ x, y, z }, block_upper))
+            { extract_block(scr, sink, { x, y, z }, block_upper); }
+          }
+        }
+      }
+
+      /* Whether the volume can vouch that no cell with an origin in
+       * [lower, upper) crosses the iso level. Cube indices of 0 and
+       * 255 produce no triangles. */
+      bool is_empty(vec3<size_t> const &lower, vec3<size_t> const &upper) const
+      {
+        using v = region::value_t;
+        region const voxels
+        {
+          { static_cast<v>(lower.x), static_cast<v>(lower.y), static_cast<v>(lower.z) },
+          { static_cast<v>(upper.x + m_unit_size),
+            static_cast<v>(upper.y + m_unit_size),
+            static_cast<v>(upper.z + m_unit_size) }
+        };
+
+        value_t min{}, max{};
+        if(!range_query<Volume>::get(m_volume, voxels, min, max))
+        { return false; }
+        return max < m_iso_level || !(min < m_iso_level);
+      }
+
+      /* Loads the positions and values of a cell's eight corners. */
+      void sample_cell(grid_cell<value_t> &grid, size_t const x,
+                       size_t const y, size_t const z) const
+      {
+        grid.p[0].x = x;
+        grid.p[0].y = y;
+        grid.p[0].z = z;
+        grid.val[0] = m_volume(x, y, z);
+
+        grid.p[1].x = x + m_unit_size;
+        grid.p[1].y = y;
+        grid.p[1].z = z; 
+        grid.val[1] = m_volume(x + m_unit_size, y, z);
+
+        grid.p[2].x = x + m_unit_size;
+        grid.p[2].y = y + m_unit_size;
+        grid.p[2].z = z;
+        grid.val[2] = m_volume(x + m_unit_size, y + m_unit_size, z);
+
+        grid.p[3].x = x;
+        grid.p[3].y = y + m_unit_size;
+        grid.p[3].z = z;
+        grid.val[3] = m_volume(x, y + m_unit_size, z);
+
+        grid.p[4].x = x;
+        grid.p[4].y = y;
+        grid.p[4].z = z + m_unit_size;
+        grid.val[4] = m_volume(x, y, z + m_unit_size);
+
+        grid.p[5].x = x + m_unit_size;
+        grid.p[5].y = y;
+        grid.p[5].z = z + m_unit_size;
+        grid.val[5] = m_volume(x + m_unit_size, y, z + m_unit_size);
+
+        grid.p[6].x = x + m_unit_size;
+        grid.p[6].y = y + m_unit_size;
+        grid.p[6].z = z + m_unit_size;
+        grid.val[6] = m_volume(x + m_unit_size, y + m_unit_size, z + m_unit_size);
+
+        grid.p[7].x = x;
+        grid.p[7].y = y + m_unit_size;
+        grid.p[7].z = z + m_unit_size;
+        grid.val[7] = m_volume(x, y + m_unit_size, z + m_unit_size);
+
+        sample_normals(grid, x, y, z, has_normal<vertex_t>{});
+      }
+
+      /* Flat shaded vertices need no gradients. */
+      void sample_normals(grid_cell<value_t> &, size_t const, size_t const,
+                          size_t const, std::false_type const) const
+      { }
+
+      /* Central differences at each corner, negated so that they point
+       * away from the solid side, as the triangles face. One of the two
+       * samples along each axis is a neighbouring corner, already loaded;
+       * only the one beyond the cell is read. At the edge of the volume,
+       * the corner itself stands in for it. */
+      void sample_normals(grid_cell<value_t> &grid, size_t const x, size_t const y,
+                          size_t const z, std::true_type const) const
+      {
+        auto const &bounds(m_volume.get_region());
+        size_t const size[3]
+        {
+          static_cast<size_t>(bounds.get_width()),
+          static_cast<size_t>(bounds.get_height()),
+          static_cast<size_t>(bounds.get_depth())
+        };
+        size_t const origin[3]{ x, y, z };
+
+        float inner[3][8], outer[3][8], sign[3][8];
+        for(size_t c{}; c < 8; ++c)
+        {
+          size_t pos[3];
+          for(size_t a{}; a < 3; ++a)
+          { pos[a] = origin[a] + corner_table[c][a] * m_unit_size; }
+          for(size_t a{}; a < 3; ++a)
+          {
+            size_t beyond[3]{ pos[0], pos[1], pos[2] };
+            bool const high{ corner_table[c][a] != 0 };
+            if(high && pos[a] + m_unit_size < size[a])
+            { beyond[a] += m_unit_size; }
+            else if(!high && pos[a] >= m_unit_size)
+            { beyond[a] -= m_unit_size; }
+
+            inner[a][c] = grid.val[corner_neighbour_table[c][a]];
+            outer[a][c] = m_volume(beyond[0], beyond[1], beyond[2]);
+            sign[a][c] = high ? -1.0f : 1.0f;
+          }
+        }
+
+        /* Straight-line over the corners, so it vectorizes. */
+        float n[3][8];
+        for(size_t a{}; a < 3; ++a)
+        {
+          for(size_t c{}; c < 8; ++c)
+          { n[a][c] = sign[a][c] * (outer[a][c] - inner[a][c]); }
+        }
+        for(size_t c{}; c < 8; ++c)
+        { grid.n[c] = { n[0][c], n[1][c], n[2][c] }; }
+      }
+
+      /* The vertex where the surface crosses the edge from corner a to
+       * corner b, with a normal when the vertex type has one. */
+      vertex_t make_vertex(grid_cell<value_t> const &g, size_t const a, size_t const b) const
+      {
+        vertex_t vert(interp(g.p[a], g.p[b], g.val[a], g.val[b]));
+        set_normal(vert, g, a, b, has_normal<vertex_t>{});
+        return vert;
+      }
+      void set_normal(vertex_t &, grid_cell<value_t> const &, size_t const,
+                      size_t const, std::false_type const) const
+      { }
+      void set_normal(vertex_t &vert, grid_cell<value_t> const &g, size_t const a,
+                      size_t const b, std::true_type const) const
+      {
+        auto const n(interp(g.n[a], g.n[b], g.val[a], g.val[b]));
+        float const length{ std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z) };
+        if(length > 0.0f)
+        { vert.n = { n.x / length, n.y / length, n.z / length }; }
+      }
+
+      template <typename Sink>
+      void extract_block(scratch &scr, Sink &sink, vec3<size_t> const &lower,
+                         vec3<size_t> const &upper) const
+      {
+        grid_cell<value_t> grid;
+        for_each_active_cell(scr, lower, upper,
+        [&](size_t const x, size_t const y, size_t const z, uint8_t const cube_index)
+        {
+          sample_cell(grid, x, y, z);
+          if(m_polygonizer == polygonizer::tetrahedra)
+          { polygonize_tetrahedra(grid, cube_index, sink); }
+          else if(m_polygonizer == polygonizer::transitions && is_transition({ x, y, z }))
+          { polygonize_transition(grid, cube_index, { x, y, z }, sink); }
+          else
+          { polygonize(grid, cube_index, sink); }
+        });
+      }
+
+      /* Calls func(x, y, z, cube_index) for each cell with an origin in
+       * [lower, upper) that the surface passes through, in x, y, z order.
+       * Bit volumes are classified a word at a time when every voxel is
+       * a corner; anything else goes a row at a time. */
+      template <typename Func>
+      void for_each_active_cell(scratch &scr, vec3<size_t> const &lower,
+                                vec3<size_t> const &upper, Func const &func) const
+      {
+        for_each_active_cell(scr, lower, upper, func,
+                             std::integral_constant<bool, word_query<Volume>::value>{});
+      }
+
+      template <typename Func>
+      void for_each_active_cell(scratch &scr, vec3<size_t> const &lower,
+                                vec3<size_t> const &upper, Func const &func,
+                                std::true_type const) const
+      {
+        if(m_unit_size == 1)
+        { classify_words(lower, upper, func); }
+        else
+        { classify_rows(scr, lower, upper, func); }
+      }
+
+      template <typename Func>
+      void for_each_active_cell(scratch &scr, vec3<size_t> const &lower,
+                                vec3<size_t> const &upper, Func const &func,
+                                std::false_type const) const
+      { classify_rows(scr, lower, upper, func); }
+
+      /* Classifies 64 cells along z at once, straight from the volume's
+       * bits. Solid and empty voxels are each entirely above or below
+       * the iso level, so each word of below-iso flags is the word of
+       * bits itself, or its inverse. */
+      template <typename Func>
+      void classify_words(vec3<size_t> const &lower, vec3<size_t> const &upper,
+                          Func const &func) const
+      {
+        bool const solid_below{ m_volume.get_solid() < m_iso_level };
+        bool const empty_below{ m_volume.get_empty() < m_iso_level };
+        if(solid_below == empty_below)
+        { return; }
+        uint64_t const invert{ empty_below ? ~uint64_t{} : uint64_t{} };
+
+        uint64_t corners[8];
+        for(size_t x{ lower.x }; x < upper.x; ++x)
+        {
+          for(size_t y{ lower.y }; y < upper.y; ++y)
+          {
+            for(size_t z{ lower.z }; z < upper.z; z += 64)
+            {
+              for(size_t c{}; c < 8; ++c)
+              {
+                auto const &offset(corner_table[c]);
+                corners[c] = m_volume.get_bits(x + offset[0], y + offset[1],
+                                               z + offset[2]) ^ invert;
+              }
+
+              size_t const count{ std::min<size_t>(upper.z - z, 64) };
+              uint64_t active{ classify::active_cells(corners) };
+              if(count < 64)
+              { active &= (uint64_t{ 1 } << count) - 1; }
+              while(active)
+              {
+                size_t const i{ classify::lowest_bit(active) };
+                active &= active - 1;
+                func(x, y, z + i, classify::cube_index(corners, i));
+              }
+            }
+          }
+        }
+      }
+
+      /* Classifies the cells a row at a time. Within a call, every
+       * voxel is sampled and compared against the iso level once. */
+      template <typename Func>
+      void classify_rows(scratch &scr, vec3<size_t> const &lower,
+                         vec3<size_t> const &upper, Func const &func) const
+      {
+        size_t const cells_y{ (upper.y - lower.y + m_unit_size - 1) / m_unit_size };
+        size_t const cells_z{ (upper.z - lower.z + m_unit_size - 1) / m_unit_size };
+        size_t const points_y{ cells_y + 1 };
+        size_t const points_z{ cells_z + 1 };
+        scr.values.resize(points_z);
+        scr.plane.resize(points_y * points_z);
+        scr.next_plane.resize(points_y * points_z);
+        scr.cubes.resize(cells_z);
+        scr.active.resize(cells_z);
+
+        uint8_t *plane{ scr.plane.data() };
+        uint8_t *next_plane{ scr.next_plane.data() };
+        classify_plane(scr, plane, lower, points_y, points_z);
+        for(size_t x{ lower.x }; x < upper.x; x += m_unit_size)
+        {
+          classify_plane(scr, next_plane, { x + m_unit_size, lower.y, lower.z },
+                         points_y, points_z);
+
+          /* Corners 0-3 of a row of cells: (x, y), (x + 1, y),
+           * (x + 1, y + 1), (x, y + 1); 4-7 follow along z. */
+          for(size_t j{}; j < cells_y; ++j)
+          {
+            classify::cube_indices(plane + j * points_z,
+                                   next_plane + j * points_z,
+                                   next_plane + (j + 1) * points_z,
+                                   plane + (j + 1) * points_z,
+                                   cells_z, scr.cubes.data());
+            size_t const found{ classify::active(scr.cubes.data(), cells_z, scr.active.data()) };
+
+            size_t const y{ lower.y + j * m_unit_size };
+            for(size_t k{}; k < found; ++k)
+            {
+              auto const cell(scr.active[k]);
+              func(x, y, lower.z + cell * m_unit_size, scr.cubes[cell]);
+            }
+          }
+
+          std::swap(plane, next_plane);
+        }
+      }
+
+      /* Flags which voxels of the y/z lattice plane at lower.x
+       * are below the iso level. */
+      void classify_plane(scratch &scr, uint8_t * const plane, vec3<size_t> const &lower,
+                          size_t const points_y, size_t const points_z) const
+      {
+        for(size_t j{}; j < points_y; ++j)
+        {
+          size_t const y{ lower.y + j * m_unit_size };
+          for(size_t k{}; k < points_z; ++k)
+          { scr.values[k] = m_volume(lower.x, y, lower.z + k * m_unit_size); }
+          classify::below(scr.values.data(), points_z, m_iso_level, plane + j * points_z);
+        }
+      }
+
       /*
          Given a grid cell and an isolevel, calculate the triangular
          facets requied to represent the isosurface through the cell.
-         Return the number of triangular facets, the array "triangles"
-         will be loaded up with the vertices at most 5 triangular facets.
-         0 will be returned if the grid cell is either totally above
-         of totally below the isolevel.
+         At most 5 triangular facets are handed to the sink; none are
+         if the grid cell is either totally above of totally below
+         the isolevel. See polygonize.h for the two implementations.
          */
-      std::vector<Triangle> polygonize(grid_cell<value_t> const g) const
-      {
-        /* Determine the index into the edge table, which
-           tells us the vertices inside of the surface. */
-        int32_t cube_index{};
-        for(size_t i{}; i < 8; ++i)
-        {
-          if(g.val[i] < m_iso_level)
-          { cube_index |= (1 << i); }
-        }
-
-        /* Cube is entirely in/out of the surface */
-        if(edge_table[cube_index] == 0)
-        { return std::vector<Triangle>(); }
-
-        /* Find the vertices where the surface intersects the cube */
-        vec3<float> verts[12];
-        if(edge_table[cube_index] & 1) 
-        { verts[0] = interp(g.p[0], g.p[1], g.val[0], g.val[1]); }
-        if(edge_table[cube_index] & 2) 
-        { verts[1] = interp(g.p[1], g.p[2], g.val[1], g.val[2]); }
-        if(edge_table[cube_index] & 4) 
-        { verts[2] = interp(g.p[2], g.p[3], g.val[2], g.val[3]); }
-        if(edge_table[cube_index] & 8) 
-        { verts[3] = interp(g.p[3], g.p[0], g.val[3], g.val[0]); }
-        if(edge_table[cube_index] & 16) 
-        { verts[4] = interp(g.p[4], g.p[5], g.val[4], g.val[5]); }
-        if(edge_table[cube_index] & 32) 
-        { verts[5] = interp(g.p[5], g.p[6], g.val[5], g.val[6]); }
-        if(edge_table[cube_index] & 64) 
-        { verts[6] = interp(g.p[6], g.p[7], g.val[6], g.val[7]); }
-        if(edge_table[cube_index] & 128) 
-        { verts[7] = interp(g.p[7], g.p[4], g.val[7], g.val[4]); }
-        if(edge_table[cube_index] & 256) 
-        { verts[8] = interp(g.p[0], g.p[4], g.val[0], g.val[4]); }
-        if(edge_table[cube_index] & 512) 
-        { verts[9] = interp(g.p[1], g.p[5], g.val[1], g.val[5]); }
-        if(edge_table[cube_index] & 1024) 
-        { verts[10] = interp(g.p[2], g.p[6], g.val[2], g.val[6]); }
-        if(edge_table[cube_index] & 2048) 
-        { verts[11] = interp(g.p[3], g.p[7], g.val[3], g.val[7]); }
-
-        /* Create the triangles */
-        std::vector<Triangle> triangles;
-        triangles.reserve(5);
-        for(size_t i{}; tri_table[cube_index][i] != -1; i += 3)
-        {
-          triangles.push_back(Triangle(
-              verts[tri_table[cube_index][i]],
-              verts[tri_table[cube_index][i + 1]],
-              verts[tri_table[cube_index][i + 2]] ));
-        }
-
-        return triangles;
+      template <typename Sink>
+      void polygonize(grid_cell<value_t> const &g, int32_t const cube_index, Sink &sink) const
+      {
+        auto const make([this, &g](size_t const a, size_t const b)
+        { return make_vertex(g, a, b); });
+#ifdef VOX_TABLE_POLYGONIZE
+        polygonize_tables<Triangle>(cube_index, make, sink);
+#else
+        polygonize_cases<Triangle>(cube_index, make, sink);
+#endif
+      }
+
+      /* Marching tetrahedra over the six tetrahedra of tetrahedron_table.
+       * Crossings are always interpolated from the lower vertex of an
+       * edge, and triangles are wound to face the corners below the
+       * iso level, as the cube table's are. */
+      template <typename Sink>
+      void polygonize_tetrahedra(grid_cell<value_t> const &g, int32_t const cube_index,
+                                 Sink &sink) const
+      {
+        for(auto const &tet : tetrahedron_table)
+        {
+          size_t below[4], above[4], below_count{}, above_count{};
+          for(size_t i{}; i < 4; ++i)
+          {
+            if(cube_index & (1 << tet[i]))
+            { below[below_count++] = i; }
+            else
+            { above[above_count++] = i; }
+          }
+          if(below_count == 0 || above_count == 0)
+          { continue; }
+
+          auto const cross([&](size_t const i, size_t const j)
+          {
+            size_t const a{ static_cast<size_t>(tet[std::min(i, j)]) };
+            size_t const b{ static_cast<size_t>(tet[std::max(i, j)]) };
+            return make_vertex(g, a, b);
+          });
+          auto const &from(g.p[tet[above[0]]]);
+          auto const &to(g.p[tet[below[0]]]);
+          vec3<float> const facing{ to.x - from.x, to.y - from.y, to.z - from.z };
+
+          if(below_count == 2)
+          {
+            /* The crossings form a quad, in order around its edge. */
+            vertex_t const quad[4]
+            {
+              cross(below[0], above[0]), cross(below[0], above[1]),
+              cross(below[1], above[1]), cross(below[1], above[0])
+            };
+            emit(sink, facing, quad[0], quad[1], quad[2]);
+            emit(sink, facing, quad[0], quad[2], quad[3]);
+          }
+          else
+          {
+            /* One corner is cut off from the other three. */
+            auto const &lone(below_count == 1 ? below : above);
+            auto const &rest(below_count == 1 ? above : below);
+            emit(sink, facing, cross(lone[0], rest[0]), cross(lone[0], rest[1]),
+                               cross(lone[0], rest[2]));
+          }
+        }
+      }
+
+      /* Whether face f of the cell, numbered as in face_table, lies on a seam. */
+      bool is_seam(vec3<size_t> const &cell, size_t const face) const
+      {
+        size_t p[3]{ cell.x, cell.y, cell.z };
+        p[face / 2] += (face % 2) * m_unit_size;
+        return seam_query<Volume>::is_seam(m_volume, p[0], p[1], p[2], face / 2);
+      }
+
+      /* Whether any face of the cell lies on a seam. */
+      bool is_transition(vec3<size_t> const &cell) const
+      {
+        for(size_t f{}; f < 6; ++f)
+        {
+          if(is_seam(cell, f))
+          { return true; }
+        }
+        return false;
+      }
+
+      /* The cell across face f, unless that's outside of the volume. */
+      bool get_neighbour(vec3<size_t> const &cell, size_t const face, vec3<size_t> &out) const
+      {
+        auto const &bounds(m_volume.get_region());
+        size_t const extent[3]
+        {
+          static_cast<size_t>(bounds.get_width()),
+          static_cast<size_t>(bounds.get_height()),
+          static_cast<size_t>(bounds.get_depth())
+        };
+        size_t p[3]{ cell.x, cell.y, cell.z };
+        size_t const axis{ face / 2 };
+        if(face % 2)
+        {
+          if(p[axis] + 2 * m_unit_size >= extent[axis])
+          { return false; }
+          p[axis] += m_unit_size;
+        }
+        else
+        {
+          if(p[axis] < m_unit_size)
+          { return false; }
+          p[axis] -= m_unit_size;
+        }
+        out = { p[0], p[1], p[2] };
+        return true;
+      }
+
+      /* Classifies a single cell, as classify_rows() would. */
+      int32_t get_cube_index(vec3<size_t> const &cell) const
+      {
+        int32_t index{};
+        for(size_t c{}; c < 8; ++c)
+        {
+          if(m_volume(cell.x + corner_table[c][0] * m_unit_size,
+                      cell.y + corner_table[c][1] * m_unit_size,
+                      cell.z + corner_table[c][2] * m_unit_size) < m_iso_level)
+          { index |= 1 << c; }
+        }
+        return index;
+      }
+
+      /* Polygonizes a cell on a seam face by face, so that each face is
+       * cut just as whatever is across it cuts it. Faces on a seam, or
+       * shared with another cell on one, are split along their lower to
+       * upper diagonal, as lod_field interpolates across seams; faces
+       * shared with a cube cell take the contour its triangles leave
+       * there. Those contours are joined into loops around the corners
+       * below the iso level, and each loop is fanned from its centre.
+       * Crossings 0-11 lie on the cube's edges and 12-17 on the faces'
+       * diagonals; next[p] is the crossing after p around its loop. */
+      template <typename Sink>
+      void polygonize_transition(grid_cell<value_t> const &g, int32_t const cube_index,
+                                 vec3<size_t> const &cell, Sink &sink) const
+      {
+        int8_t next[18];
+        for(auto &n : next)
+        { n = -1; }
+        auto const below([cube_index](int const corner)
+        { return ((cube_index >> corner) & 1) != 0; });
+
+        for(size_t f{}; f < 6; ++f)
+        {
+          auto const &corners(face_table[f]);
+          auto const &edges(face_edge_table[f]);
+          vec3<size_t> across;
+          if(!is_seam(cell, f) && get_neighbour(cell, f, across) && !is_transition(across))
+          {
+            trace_face(f, get_cube_index(across), below, next);
+            continue;
+          }
+
+          /* Each half is walked counter-clockwise from outside; the
+           * contour runs from where the walk leaves the corners below
+           * the iso level to where it comes back. */
+          int8_t const diagonal(static_cast<int8_t>(12 + f));
+          int const halves[2][3]
+          {
+            { corners[0], corners[1], corners[2] },
+            { corners[0], corners[2], corners[3] }
+          };
+          int8_t const sides[2][3]
+          {
+            { static_cast<int8_t>(edges[0]), static_cast<int8_t>(edges[1]), diagonal },
+            { diagonal, static_cast<int8_t>(edges[2]), static_cast<int8_t>(edges[3]) }
+          };
+          for(size_t h{}; h < 2; ++h)
+          {
+            int8_t leave{ -1 }, enter{ -1 };
+            for(size_t i{}; i < 3; ++i)
+            {
+              bool const from{ below(halves[h][i]) }, to{ below(halves[h][(i + 1) % 3]) };
+              if(from && !to)
+              { leave = sides[h][i]; }
+              else if(!from && to)
+              { enter = sides[h][i]; }
+            }
+            if(leave >= 0 && enter >= 0)
+            { next[leave] = enter; }
+          }
+        }
+
+        bool used[18]{};
+        vertex_t loop[18];
+        for(size_t start{}; start < 18; ++start)
+        {
+          if(next[start] < 0 || used[start])
+          { continue; }
+
+          size_t count{};
+          for(int8_t p(static_cast<int8_t>(start)); p >= 0 && !used[p]; p = next[p])
+          {
+            used[p] = true;
+            loop[count++] = p < 12
+              ? make_vertex(g, polygonize_edge_table[p][0], polygonize_edge_table[p][1])
+              : make_vertex(g, face_table[p - 12][0], face_table[p - 12][2]);
+          }
+
+          /* Loops run counter-clockwise seen from below the iso level,
+           * which is the way the cube table's triangles face. */
+          if(count == 3)
+          { sink(Triangle(loop[0], loop[1], loop[2])); }
+          else
+          {
+            vertex_t const centre(make_centre(loop, count));
+            for(size_t i{}; i < count; ++i)
+            { sink(Triangle(centre, loop[i], loop[(i + 1) % count])); }
+          }
+        }
+      }
+
+      /* Joins the crossings on face f of a cell as the cube table joins
+       * them in the cell across it, whose cube index is given. Only a
+       * face with a corner of each kind at either end of both diagonals
+       * can be joined two ways; that's settled by which pairs of its
+       * edges the table's triangles run between, inside the face. */
+      template <typename Below>
+      void trace_face(size_t const f, int32_t const across, Below const &below,
+                      int8_t (&next)[18]) const
+      {
+        auto const &corners(face_table[f]);
+        auto const &edges(face_edge_table[f]);
+        size_t leave[2], enter[2], count{}, entered{};
+        for(size_t i{}; i < 4; ++i)
+        {
+          bool const from{ below(corners[i]) }, to{ below(corners[(i + 1) % 4]) };
+          if(from && !to)
+          { leave[count++] = i; }
+          else if(!from && to)
+          { enter[entered++] = i; }
+        }
+        if(count == 1)
+        {
+          next[edges[leave[0]]] = static_cast<int8_t>(edges[enter[0]]);
+          return;
+        }
+        if(count == 0)
+        { return; }
+
+        /* The neighbour's edges, as sides of this face. */
+        size_t const axis{ f / 2 };
+        int side[12];
+        for(auto &s : side)
+        { s = -1; }
+        for(size_t i{}; i < 4; ++i)
+        {
+          int const a{ corner_neighbour_table[corners[i]][axis] };
+          int const b{ corner_neighbour_table[corners[(i + 1) % 4]][axis] };
+          for(size_t e{}; e < 12; ++e)
+          {
+            if((edge_corner_table[e][0] == a && edge_corner_table[e][1] == b) ||
+               (edge_corner_table[e][0] == b && edge_corner_table[e][1] == a))
+            { side[e] = static_cast<int>(i); }
+          }
+        }
+
+        /* Edges shared by two triangles aren't on the contour. */
+        bool joined[4][4]{};
+        for(size_t t{}; tri_table[across][t] != -1; t += 3)
+        {
+          for(size_t j{}; j < 3; ++j)
+          {
+            int const u{ side[tri_table[across][t + j]] };
+            int const w{ side[tri_table[across][t + (j + 1) % 3]] };
+            if(u >= 0 && w >= 0 && u != w)
+            {
+              joined[u][w] = !joined[u][w];
+              joined[w][u] = !joined[w][u];
+            }
+          }
+        }
+        for(size_t l{}; l < 2; ++l)
+        {
+          for(size_t e{}; e < 2; ++e)
+          {
+            if(joined[leave[l]][enter[e]])
+            { next[edges[leave[l]]] = static_cast<int8_t>(edges[enter[e]]); }
+          }
+        }
+      }
+
+      /* The mean of the vertices, with their normals averaged when
+       * the vertex type has them. */
+      vertex_t make_centre(vertex_t const *verts, size_t const count) const
+      {
+        vec3<float> p{};
+        for(size_t i{}; i < count; ++i)
+        {
+          p.x += verts[i].p.x;
+          p.y += verts[i].p.y;
+          p.z += verts[i].p.z;
+        }
+        float const scale{ 1.0f / count };
+        vertex_t centre(vec3<float>{ p.x * scale, p.y * scale, p.z * scale });
+        set_centre_normal(centre, verts, count, has_normal<vertex_t>{});
+        return centre;
+      }
+      void set_centre_normal(vertex_t &, vertex_t const *, size_t const,
+                             std::false_type const) const
+      { }
+      void set_centre_normal(vertex_t &centre, vertex_t const *verts, size_t const count,
+                             std::true_type const) const
+      {
+        vec3<float> n{};
+        for(size_t i{}; i < count; ++i)
+        {
+          n.x += verts[i].n.x;
+          n.y += verts[i].n.y;
+          n.z += verts[i].n.z;
+        }
+        float const length{ std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z) };
+        if(length > 0.0f)
+        { centre.n = { n.x / length, n.y / length, n.z / length }; }
+      }
+
+      /* Hands a triangle to the sink, flipping it unless its normal
+       * points along facing. */
+      template <typename Sink>
+      void emit(Sink &sink, vec3<float> const &facing, vertex_t const &v0,
+                vertex_t const &v1, vertex_t const &v2) const
+      {
+        vec3<float> const a{ v0.p.x - v1.p.x, v0.p.y - v1.p.y, v0.p.z - v1.p.z };
+        vec3<float> const b{ v1.p.x - v2.p.x, v1.p.y - v2.p.y, v1.p.z - v2.p.z };
+        float const dot{ (a.y * b.z - a.z * b.y) * facing.x +
+                         (a.z * b.x - a.x * b.z) * facing.y +
+                         (a.x * b.y - a.y * b.x) * facing.z };
+        if(dot < 0.0f)
+        { sink(Triangle(v0, v2, v1)); }
+        else
+        { sink(Triangle(v0, v1, v2)); }
       }
 
       vec3<float> interp(vec3<float> const &p1, vec3<float> const &p2, float valp1, float valp2) const
@@ -203,5 +1018,8 @@ namespace vox
       region const m_region;
       value_t const m_iso_level;
       size_t const m_unit_size;
+      polygonizer const m_polygonizer;
+      static size_t constexpr const m_block_voxels{ 16 };
+      static size_t constexpr const m_block_cells{ 8 };
   };
 }
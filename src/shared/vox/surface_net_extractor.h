@@ -0,0 +1,357 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/surface_net_extractor.h
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    Naive surface nets. Every cell the surface passes
+    through gets one vertex, at the mean of its edge
+    crossings, and every lattice edge the surface crosses
+    becomes a quad joining the four cells around it.
+    Vertices sit well inside their cells, so there are
+    none of marching cubes' slivers.
+*/
+
+#pragma once
+
+#include <vector>
+#include <future>
+#include <limits>
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+#include <type_traits>
+
+#include "tables.h"
+#include "region.h"
+#include "vertex.h"
+#include "indexed_surface.h"
+#include "range_query.h"
+#include "util/thread_pool.h"
+
+namespace vox
+{
+  template <typename Vertex, typename Volume>
+  class surface_net_extractor
+  {
+    public:
+      using this_t = surface_net_extractor<Vertex, Volume>;
+      using vertex_t = Vertex;
+      using indexed_surface_t = indexed_surface<Vertex>;
+      using index_t = typename indexed_surface_t::index_t;
+      using value_t = typename Volume::value_t;
+
+      /* Cells lie on the same lattice as surface_extractor's. */
+      surface_net_extractor(Volume const &vol, region const &reg,
+                            value_t const level, size_t const unit)
+        : m_volume(vol)
+        , m_region(reg)
+        , m_iso_level(level)
+        , m_unit_size(unit)
+      { assert(m_volume.get_region().contains(m_region)); }
+
+      this_t& operator =(this_t const &) = delete;
+
+      region const& get_region() const
+      { return m_region; }
+
+      indexed_surface_t operator ()() const
+      { return extract_slab(0, get_cells_x()); }
+
+      /* Extracts each x-slab of cells as its own task on the pool.
+       * A slab also places the vertices of the plane of cells just
+       * before it, so those few vertices appear twice in the output. */
+      indexed_surface_t operator ()(util::thread_pool &pool) const
+      {
+        size_t const cells_x{ get_cells_x() };
+        std::vector<std::future<indexed_surface_t>> slabs;
+        for(size_t i{}; i < cells_x; i += m_slab_cells)
+        {
+          size_t const end{ std::min(i + m_slab_cells, cells_x) };
+          slabs.push_back(pool.submit([this, i, end]
+          { return extract_slab(i, end); }));
+        }
+
+        indexed_surface_t surface(m_region);
+        for(auto &fut : slabs)
+        { surface.add_surface(fut.get()); }
+        return surface;
+      }
+
+    private:
+      /* The vertex and corner mask of each cell of a y/z plane. */
+      struct plane
+      {
+        plane(size_t const cells)
+          : vertices(cells), masks(cells)
+        { }
+
+        std::vector<index_t> vertices;
+        std::vector<uint8_t> masks;
+      };
+
+      /* Which y/z blocks can be skipped, for a run of planes
+       * m_block_cells long; blocks are cubes of cells. */
+      struct skip_list
+      {
+        size_t group{ std::numeric_limits<size_t>::max() };
+        std::vector<uint8_t> empty;
+      };
+
+      static size_t get_cells(region::value_t const lower, region::value_t const upper,
+                              size_t const unit)
+      {
+        auto const span(upper - static_cast<region::value_t>(unit) - lower);
+        return span > 0 ? (static_cast<size_t>(span) + unit - 1) / unit : 0;
+      }
+      size_t get_cells_x() const
+      { return get_cells(m_region.lower_corner.x, m_region.upper_corner.x, m_unit_size); }
+      size_t get_cells_y() const
+      { return get_cells(m_region.lower_corner.y, m_region.upper_corner.y, m_unit_size); }
+      size_t get_cells_z() const
+      { return get_cells(m_region.lower_corner.z, m_region.upper_corner.z, m_unit_size); }
+
+      /* Places the vertices of the planes of cells before and in
+       * [begin, end), and emits the quads of the edges at the origins
+       * of the cells in [begin, end). */
+      indexed_surface_t extract_slab(size_t const begin, size_t const end) const
+      {
+        indexed_surface_t surface(m_region);
+        size_t const cells_y{ get_cells_y() }, cells_z{ get_cells_z() };
+        if(begin == end || !cells_y || !cells_z)
+        { return surface; }
+
+        plane prev(cells_y * cells_z), curr(cells_y * cells_z);
+        skip_list skip;
+        if(begin > 0)
+        { place_vertices(surface, prev, skip, begin - 1, cells_y, cells_z); }
+        for(size_t i{ begin }; i < end; ++i)
+        {
+          place_vertices(surface, curr, skip, i, cells_y, cells_z);
+          emit_quads(surface, prev, curr, i, cells_y, cells_z);
+          std::swap(prev, curr);
+        }
+        return surface;
+      }
+
+      /* Fills in the i'th plane of cells along x a block at a time,
+       * skipping blocks the volume knows not to cross the surface. */
+      void place_vertices(indexed_surface_t &surface, plane &pl, skip_list &skip,
+                          size_t const i, size_t const cells_y, size_t const cells_z) const
+      {
+        std::fill(pl.masks.begin(), pl.masks.end(), 0);
+        std::fill(pl.vertices.begin(), pl.vertices.end(),
+                  std::numeric_limits<index_t>::max());
+
+        size_t const blocks_z{ (cells_z + m_block_cells - 1) / m_block_cells };
+        if(skip.group != i / m_block_cells)
+        { find_empty(skip, i / m_block_cells, cells_y, cells_z); }
+
+        size_t const x{ m_region.lower_corner.x + i * m_unit_size };
+        size_t const points{ m_block_cells + 1 };
+        value_t near[points * points], far[points * points], values[8];
+        for(size_t block_j{}; block_j < cells_y; block_j += m_block_cells)
+        {
+          size_t const end_j{ std::min(block_j + m_block_cells, cells_y) };
+          for(size_t block_k{}; block_k < cells_z; block_k += m_block_cells)
+          {
+            size_t const end_k{ std::min(block_k + m_block_cells, cells_z) };
+            if(skip.empty[(block_j / m_block_cells) * blocks_z + block_k / m_block_cells])
+            { continue; }
+
+            /* The block's points on the planes at x and x + unit, sampled
+             * once each; every cell reads its corners from these. */
+            for(size_t j{ block_j }; j <= end_j; ++j)
+            {
+              size_t const y{ m_region.lower_corner.y + j * m_unit_size };
+              for(size_t k{ block_k }; k <= end_k; ++k)
+              {
+                size_t const z{ m_region.lower_corner.z + k * m_unit_size };
+                size_t const point{ (j - block_j) * points + (k - block_k) };
+                near[point] = m_volume(x, y, z);
+                far[point] = m_volume(x + m_unit_size, y, z);
+              }
+            }
+
+            for(size_t j{ block_j }; j < end_j; ++j)
+            {
+              size_t const y{ m_region.lower_corner.y + j * m_unit_size };
+              for(size_t k{ block_k }; k < end_k; ++k)
+              {
+                size_t const z{ m_region.lower_corner.z + k * m_unit_size };
+                size_t const point{ (j - block_j) * points + (k - block_k) };
+                uint8_t mask{};
+                for(size_t c{}; c < 8; ++c)
+                {
+                  size_t const corner{ point + corner_table[c][1] * points + corner_table[c][2] };
+                  values[c] = corner_table[c][0] ? far[corner] : near[corner];
+                  if(values[c] < m_iso_level)
+                  { mask |= static_cast<uint8_t>(1 << c); }
+                }
+                if(mask == 0 || mask == 255)
+                { continue; }
+
+                pl.masks[j * cells_z + k] = mask;
+                pl.vertices[j * cells_z + k] = surface.add_vertex(make_vertex(values, mask, x, y, z));
+              }
+            }
+          }
+        }
+      }
+
+      /* Asks the volume, for each block of cells in the given group of
+       * planes, whether it can vouch that none cross the iso level. */
+      void find_empty(skip_list &skip, size_t const group,
+                      size_t const cells_y, size_t const cells_z) const
+      {
+        using v = region::value_t;
+        v const unit(m_unit_size);
+        size_t const begin_i{ group * m_block_cells };
+        size_t const end_i{ std::min(begin_i + m_block_cells, get_cells_x()) };
+        size_t const blocks_y{ (cells_y + m_block_cells - 1) / m_block_cells };
+        size_t const blocks_z{ (cells_z + m_block_cells - 1) / m_block_cells };
+        skip.group = group;
+        skip.empty.assign(blocks_y * blocks_z, 0);
+
+        auto const lower([&](v const corner, size_t const cell)
+        { return corner + static_cast<v>(cell) * unit; });
+        for(size_t by{}; by < blocks_y; ++by)
+        {
+          size_t const begin_j{ by * m_block_cells };
+          size_t const end_j{ std::min(begin_j + m_block_cells, cells_y) };
+          for(size_t bz{}; bz < blocks_z; ++bz)
+          {
+            size_t const begin_k{ bz * m_block_cells };
+            size_t const end_k{ std::min(begin_k + m_block_cells, cells_z) };
+            region const voxels
+            {
+              { lower(m_region.lower_corner.x, begin_i), lower(m_region.lower_corner.y, begin_j),
+                lower(m_region.lower_corner.z, begin_k) },
+              { lower(m_region.lower_corner.x, end_i) + 1, lower(m_region.lower_corner.y, end_j) + 1,
+                lower(m_region.lower_corner.z, end_k) + 1 }
+            };
+
+            value_t min{}, max{};
+            if(range_query<Volume>::get(m_volume, voxels, min, max))
+            { skip.empty[by * blocks_z + bz] = max < m_iso_level || !(min < m_iso_level); }
+          }
+        }
+      }
+
+      /* The mean of the cell's edge crossings. */
+      vertex_t make_vertex(value_t const (&values)[8], uint8_t const mask,
+                           size_t const x, size_t const y, size_t const z) const
+      {
+        float sum[3]{};
+        size_t crossings{};
+        for(size_t e{}; e < 12; ++e)
+        {
+          auto const a(edge_corner_table[e][0]), b(edge_corner_table[e][1]);
+          if(((mask >> a) & 1) == ((mask >> b) & 1))
+          { continue; }
+
+          float const mu{ (static_cast<float>(m_iso_level) - values[a]) /
+                          (static_cast<float>(values[b]) - values[a]) };
+          for(size_t axis{}; axis < 3; ++axis)
+          { sum[axis] += corner_table[a][axis] + mu * (corner_table[b][axis] - corner_table[a][axis]); }
+          ++crossings;
+        }
+
+        float const scale{ static_cast<float>(m_unit_size) / crossings };
+        vertex_t vert(vec3<float>
+        {
+          x + sum[0] * scale,
+          y + sum[1] * scale,
+          z + sum[2] * scale
+        });
+        set_normal(vert, values, has_normal<vertex_t>{});
+        return vert;
+      }
+
+      void set_normal(vertex_t &, value_t const (&)[8], std::false_type const) const
+      { }
+
+      /* The cell's own gradient, from its corners, negated so that
+       * it points away from the solid side. */
+      void set_normal(vertex_t &vert, value_t const (&values)[8], std::true_type const) const
+      {
+        float n[3]{};
+        for(size_t c{}; c < 8; ++c)
+        {
+          for(size_t axis{}; axis < 3; ++axis)
+          { n[axis] += corner_table[c][axis] ? -1.0f * values[c] : 1.0f * values[c]; }
+        }
+        float const length{ std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]) };
+        if(length > 0.0f)
+        { vert.n = { n[0] / length, n[1] / length, n[2] / length }; }
+      }
+
+      /* Every edge leaving a cell's origin in +x, +y, or +z is shared
+       * with three cells on the lower side along the other two axes.
+       * When all four exist and the edge crosses the surface, they're
+       * joined by a quad which faces the edge's below-iso end. */
+      void emit_quads(indexed_surface_t &surface, plane const &prev, plane const &curr,
+                      size_t const i, size_t const cells_y, size_t const cells_z) const
+      {
+        for(size_t j{}; j < cells_y; ++j)
+        {
+          for(size_t k{}; k < cells_z; ++k)
+          {
+            size_t const cell{ j * cells_z + k };
+            uint8_t const mask{ curr.masks[cell] };
+            if(!mask)
+            { continue; }
+
+            bool const below{ (mask & 1) != 0 };
+            if(j > 0 && k > 0 && below != ((mask >> 1) & 1))
+            {
+              /* Along x; around it in y, z. */
+              emit_quad(surface, !below,
+                        curr.vertices[cell - cells_z - 1], curr.vertices[cell - 1],
+                        curr.vertices[cell], curr.vertices[cell - cells_z]);
+            }
+            if(i > 0 && k > 0 && below != ((mask >> 3) & 1))
+            {
+              /* Along y; around it in z, x. */
+              emit_quad(surface, !below,
+                        prev.vertices[cell - 1], prev.vertices[cell],
+                        curr.vertices[cell], curr.vertices[cell - 1]);
+            }
+            if(i > 0 && j > 0 && below != ((mask >> 4) & 1))
+            {
+              /* Along z; around it in x, y. */
+              emit_quad(surface, !below,
+                        prev.vertices[cell - cells_z], curr.vertices[cell - cells_z],
+                        curr.vertices[cell], prev.vertices[cell]);
+            }
+          }
+        }
+      }
+
+      /* The corners are given counterclockwise around the edge's
+       * positive direction; forward means the far end is below. */
+      void emit_quad(indexed_surface_t &surface, bool const forward, index_t const a,
+                     index_t const b, index_t const c, index_t const d) const
+      {
+        if(forward)
+        {
+          surface.add_triangle(a, b, c);
+          surface.add_triangle(a, c, d);
+        }
+        else
+        {
+          surface.add_triangle(a, c, b);
+          surface.add_triangle(a, d, c);
+        }
+      }
+
+      Volume const &m_volume;
+      region const m_region;
+      value_t const m_iso_level;
+      size_t const m_unit_size;
+      static size_t constexpr const m_block_cells{ 8 };
+      static size_t constexpr const m_slab_cells{ 16 };
+  };
+}
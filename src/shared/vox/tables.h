@@ -367,3 +367,87 @@ int constexpr const tri_table[256][16] =
   { 0, 3, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
   { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 }
 };
+
+/*
+  Offsets of the eight cube vertices from vertex 0, in units of
+  the cell size, following the numbering in the diagram above.
+*/
+int constexpr const corner_table[8][3] =
+{
+  { 0, 0, 0 }, { 1, 0, 0 }, { 1, 1, 0 }, { 0, 1, 0 },
+  { 0, 0, 1 }, { 1, 0, 1 }, { 1, 1, 1 }, { 0, 1, 1 }
+};
+
+/*
+  The two vertices joined by each of the twelve edges, listed with
+  the vertex nearer the origin first. Interpolating from the first
+  to the second gives the same result no matter which of the (up to
+  four) cells sharing the edge does the work.
+*/
+int constexpr const edge_corner_table[12][2] =
+{
+  { 0, 1 }, { 1, 2 }, { 3, 2 }, { 0, 3 },
+  { 4, 5 }, { 5, 6 }, { 7, 6 }, { 4, 7 },
+  { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }
+};
+
+/*
+  Every lattice point owns the three edges leaving it in the positive
+  x, y, and z directions. For each of the twelve cube edges, this gives
+  the owning point's offset from vertex 0 and the axis (0 = x, 1 = y,
+  2 = z) of the edge. Cells sharing an edge therefore agree on a key
+  for it, which lets extracted vertices be cached and shared.
+*/
+int constexpr const edge_owner_table[12][4] =
+{
+  { 0, 0, 0, 0 }, { 1, 0, 0, 1 }, { 0, 1, 0, 0 }, { 0, 0, 0, 1 },
+  { 0, 0, 1, 0 }, { 1, 0, 1, 1 }, { 0, 1, 1, 0 }, { 0, 0, 1, 1 },
+  { 0, 0, 0, 2 }, { 1, 0, 0, 2 }, { 1, 1, 0, 2 }, { 0, 1, 0, 2 }
+};
+
+/*
+  Splits a cube into six tetrahedra around its 0-6 diagonal. Each
+  follows a path from vertex 0 to vertex 6 which steps along one axis
+  at a time, so every tetrahedron's vertices are listed in increasing
+  position along each axis. Every face of the cube is split along the
+  diagonal from its lowest to its highest vertex, which neighbouring
+  cubes, and cubes of twice the size, agree on.
+*/
+int constexpr const tetrahedron_table[6][4] =
+{
+  { 0, 1, 2, 6 }, { 0, 1, 5, 6 }, { 0, 3, 2, 6 },
+  { 0, 3, 7, 6 }, { 0, 4, 5, 6 }, { 0, 4, 7, 6 }
+};
+
+/*
+  For each cube vertex, the vertex it shares an x, y, and z edge with.
+  Along with the voxel one step beyond the cube on the other side,
+  these give a central difference at the vertex.
+*/
+int constexpr const corner_neighbour_table[8][3] =
+{
+  { 1, 3, 4 }, { 0, 2, 5 }, { 3, 1, 6 }, { 2, 0, 7 },
+  { 5, 7, 0 }, { 4, 6, 1 }, { 7, 5, 2 }, { 6, 4, 3 }
+};
+
+/*
+  The corners of each face, counter-clockwise as seen from outside
+  the cube, starting from the face's lowest corner; corners 0 and 2
+  are the ends of its lower-to-upper diagonal. Face f is the one at
+  the lower (f even) or upper (f odd) end of axis f / 2.
+*/
+int constexpr const face_table[6][4] =
+{
+  { 0, 4, 7, 3 }, { 1, 2, 6, 5 }, { 0, 1, 5, 4 },
+  { 3, 7, 6, 2 }, { 0, 3, 2, 1 }, { 4, 5, 6, 7 }
+};
+
+/*
+  The edges around each face, in the same order; edge i joins
+  corners i and i + 1 of face_table.
+*/
+int constexpr const face_edge_table[6][4] =
+{
+  { 8, 7, 11, 3 }, { 1, 10, 5, 9 }, { 0, 9, 4, 8 },
+  { 11, 6, 10, 2 }, { 3, 2, 1, 0 }, { 4, 5, 6, 7 }
+};
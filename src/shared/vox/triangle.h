@@ -11,34 +11,40 @@
 
 #pragma once
 
-#include <OgreVector3.h>
-
 #include "vertex.h"
+#include "normals.h"
 
 namespace vox
 {
+  /* Flat shaded. The normal isn't worked out as each triangle is
+   * made; call calculate_normal(), or calculate_normals() on the
+   * surface once extraction is done, to do them all in a batch. */
   struct triangle_p
   {
     using vertex_t = vertex_p;
 
     triangle_p() = default;
     triangle_p(vertex_t const &v0, vertex_t const &v1, vertex_t const &v2)
-      : verts({ v0, v1, v2})
-    { calculate_normal(); }
+      : verts{ v0, v1, v2 }
+    { }
 
     void calculate_normal()
-    {
-      Ogre::Vector3 const a{ verts[0].p.x - verts[1].p.x,
-                             verts[0].p.y - verts[1].p.y,
-                             verts[0].p.z - verts[1].p.z };
-      Ogre::Vector3 const b{ verts[1].p.x - verts[2].p.x,
-                             verts[1].p.y - verts[2].p.y,
-                             verts[1].p.z - verts[2].p.z };
-      normal = a.crossProduct(b);
-      normal.normalise();
-    }
+    { normal = normals::face(verts[0].p, verts[1].p, verts[2].p); }
+
+    vertex_t verts[3];
+    vec3<float> normal{ 0.0f, 1.0f, 0.0f };
+  };
+
+  /* Shaded per vertex; there's no face normal to compute. */
+  struct triangle_pn
+  {
+    using vertex_t = vertex_pn;
+
+    triangle_pn() = default;
+    triangle_pn(vertex_t const &v0, vertex_t const &v1, vertex_t const &v2)
+      : verts{ v0, v1, v2 }
+    { }
 
     vertex_t verts[3];
-    Ogre::Vector3 normal{ 0.0f, 1.0f, 0.0f };
   };
 }
@@ -11,6 +11,10 @@
 
 #pragma once
 
+#include <type_traits>
+#include <utility>
+#include <cstdint>
+
 #include "vec3.h"
 
 namespace vox
@@ -24,4 +28,38 @@ namespace vox
 
     vec3<float> p;
   };
+
+  /* A position with a smooth normal; the extractors fill the
+   * normal from the volume's gradient. */
+  struct vertex_pn
+  {
+    vertex_pn() = default;
+    vertex_pn(vec3<float> const &vp)
+      : p(vp)
+    { }
+    vertex_pn(vec3<float> const &vp, vec3<float> const &vn)
+      : p(vp), n(vn)
+    { }
+
+    vec3<float> p;
+    vec3<float> n{ 0.0f, 1.0f, 0.0f };
+  };
+
+  /* A vertex_pn squeezed into 12 bytes, for upload; see quantize.h.
+   * The position is in steps relative to an origin, with a w of 1,
+   * and the normal is octahedral, in the first two bytes of n. */
+  struct vertex_q
+  {
+    int16_t p[4];
+    uint8_t n[4];
+  };
+  static_assert(sizeof(vertex_q) == 12, "vertex_q needs to be tightly packed");
+
+  /* Whether a vertex type carries a normal for the extractors to fill. */
+  template <typename Vertex, typename Enable = void>
+  struct has_normal : std::false_type
+  { };
+  template <typename Vertex>
+  struct has_normal<Vertex, decltype(void(std::declval<Vertex&>().n))> : std::true_type
+  { };
 }
@@ -0,0 +1,194 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/volume_file.cpp
+  Author: Jesse 'Jeaye' Wilkerson
+*/
+
+#include "volume_file.h"
+
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "log/logger.h"
+
+namespace vox
+{
+  namespace
+  {
+    /* Files are only ever read back by the machine which wrote
+     * them, so the header is stored as is. */
+    struct header
+    {
+      char magic[8];
+      uint32_t version;
+      uint32_t reserved;
+      volume_key key;
+      uint64_t data_offset;
+      uint64_t data_size;
+    };
+
+    char constexpr const magic[8]{ 'v', 'a', 'n', 'i', 't', 'y', 'v', 'x' };
+    uint64_t constexpr const data_offset{ 4096 };
+
+    bool same_key(volume_key const &a, volume_key const &b)
+    {
+      return a.source_hash == b.source_hash &&
+             a.width == b.width && a.height == b.height && a.depth == b.depth &&
+             a.value_size == b.value_size && a.layout == b.layout;
+    }
+
+    bool write_all(int const fd, void const * const data, size_t const size)
+    {
+      auto const *bytes(static_cast<char const*>(data));
+      size_t written{};
+      while(written < size)
+      {
+        auto const result(::write(fd, bytes + written, size - written));
+        if(result < 0)
+        {
+          if(errno == EINTR)
+          { continue; }
+          return false;
+        }
+        written += static_cast<size_t>(result);
+      }
+      return true;
+    }
+  }
+
+  uint64_t volume_file::hash(void const * const data, size_t const size, uint64_t const seed)
+  {
+    auto const *bytes(static_cast<unsigned char const*>(data));
+    uint64_t h{ seed };
+    for(size_t i{}; i < size; ++i)
+    {
+      h ^= bytes[i];
+      h *= 0x100000001b3ull;
+    }
+    return h;
+  }
+
+  bool volume_file::write(std::string const &path, volume_key const &key,
+                          void const * const data, size_t const size)
+  {
+    std::string const temp{ path + ".tmp" };
+    int const fd{ ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644) };
+    if(fd < 0)
+    {
+      log_error("unable to create volume file %%: %%", temp, std::strerror(errno));
+      return false;
+    }
+
+    header head;
+    std::memset(&head, 0, sizeof(head));
+    std::memcpy(head.magic, magic, sizeof(magic));
+    head.version = version;
+    head.key = key;
+    head.data_offset = data_offset;
+    head.data_size = size;
+
+    char padding[data_offset - sizeof(header)]{};
+    bool const written{ write_all(fd, &head, sizeof(head)) &&
+                        write_all(fd, padding, sizeof(padding)) &&
+                        write_all(fd, data, size) };
+    bool const closed{ ::close(fd) == 0 };
+    if(!written || !closed || std::rename(temp.c_str(), path.c_str()) != 0)
+    {
+      log_error("unable to write volume file %%: %%", path, std::strerror(errno));
+      std::remove(temp.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  volume_file::volume_file(std::string const &path, volume_key const &key)
+  {
+    int const fd{ ::open(path.c_str(), O_RDONLY) };
+    if(fd < 0)
+    { return; }
+
+    struct stat info;
+    header head;
+    bool const valid
+    {
+      ::fstat(fd, &info) == 0 &&
+      static_cast<size_t>(info.st_size) >= sizeof(head) &&
+      ::pread(fd, &head, sizeof(head), 0) == static_cast<ssize_t>(sizeof(head)) &&
+      std::memcmp(head.magic, magic, sizeof(magic)) == 0 &&
+      head.version == version &&
+      same_key(head.key, key) &&
+      head.data_offset == data_offset &&
+      head.data_offset + head.data_size == static_cast<uint64_t>(info.st_size)
+    };
+    if(!valid)
+    {
+      ::close(fd);
+      log_info("volume file %% is stale", path);
+      return;
+    }
+
+    /* The mapping holds its own reference to the file. */
+    void * const mapping{ ::mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE,
+                                 MAP_PRIVATE, fd, 0) };
+    ::close(fd);
+    if(mapping == MAP_FAILED)
+    {
+      log_error("unable to map volume file %%: %%", path, std::strerror(errno));
+      return;
+    }
+    ::madvise(mapping, info.st_size, MADV_WILLNEED);
+
+    m_mapping = mapping;
+    m_mapping_size = info.st_size;
+    m_size = head.data_size;
+  }
+
+  volume_file::volume_file(volume_file &&vf)
+    : m_mapping(vf.m_mapping)
+    , m_mapping_size(vf.m_mapping_size)
+    , m_size(vf.m_size)
+  {
+    vf.m_mapping = nullptr;
+    vf.m_mapping_size = vf.m_size = 0;
+  }
+
+  volume_file::~volume_file()
+  { close(); }
+
+  volume_file& volume_file::operator =(volume_file &&vf)
+  {
+    if(this != &vf)
+    {
+      close();
+      std::swap(m_mapping, vf.m_mapping);
+      std::swap(m_mapping_size, vf.m_mapping_size);
+      std::swap(m_size, vf.m_size);
+    }
+    return *this;
+  }
+
+  void* volume_file::data() const
+  {
+    if(!m_mapping)
+    { return nullptr; }
+    return static_cast<char*>(m_mapping) + data_offset;
+  }
+
+  void volume_file::close()
+  {
+    if(m_mapping)
+    { ::munmap(m_mapping, m_mapping_size); }
+    m_mapping = nullptr;
+    m_mapping_size = m_size = 0;
+  }
+}
@@ -0,0 +1,76 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/volume_file.h
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    A dense volume saved to disk, keyed by a hash of
+    whatever it was generated from and by its shape.
+    Voxels start on a page boundary, in layout order,
+    so the file can be mapped and used as storage.
+*/
+
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+
+namespace vox
+{
+  /* Everything a saved volume must match to be reused. */
+  struct volume_key
+  {
+    uint64_t source_hash;
+    int32_t width, height, depth;
+    uint32_t value_size;
+    uint32_t layout;
+  };
+
+  class volume_file
+  {
+    public:
+      /* Bump whenever the header or the voxel encoding changes. */
+      static uint32_t constexpr const version{ 1 };
+
+      /* 64-bit FNV-1a; pass the previous result as the seed
+       * to hash several buffers as one. */
+      static uint64_t hash(void const * const data, size_t const size,
+                           uint64_t const seed = 0xcbf29ce484222325ull);
+
+      /* Writes to a temporary file which is renamed into place, so
+       * a crash never leaves a truncated file behind. Returns false,
+       * and logs why, if the file couldn't be written. */
+      static bool write(std::string const &path, volume_key const &key,
+                        void const * const data, size_t const size);
+
+      volume_file() = default;
+      /* Maps the file privately; writes to the mapping are copy on write
+       * and never reach the disk. Leaves the file closed if it's missing,
+       * of another version, or saved with a different key. */
+      volume_file(std::string const &path, volume_key const &key);
+      volume_file(volume_file &&vf);
+      volume_file(volume_file const &) = delete;
+      ~volume_file();
+
+      volume_file& operator =(volume_file &&vf);
+      volume_file& operator =(volume_file const &) = delete;
+
+      bool is_open() const
+      { return m_mapping != nullptr; }
+
+      /* The voxels, or nullptr if closed. */
+      void* data() const;
+      size_t size() const
+      { return m_size; }
+
+    private:
+      void close();
+
+      void *m_mapping{};
+      size_t m_mapping_size{};
+      size_t m_size{};
+  };
+}
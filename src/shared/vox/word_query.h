@@ -0,0 +1,38 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: vox/word_query.h
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    Lets the extractors read a volume 64 voxels at a
+    time, as bits, when it only holds two values. Volumes
+    opt in by providing:
+
+      uint64_t get_bits(size_t x, size_t y, size_t z) const;
+      value_t get_solid() const;
+      value_t get_empty() const;
+
+    where bit i of get_bits is set if (x, y, z + i) is
+    solid. See bit_volume.h.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+
+namespace vox
+{
+  /* Fallback; the volume has to be sampled a voxel at a time. */
+  template <typename Volume, typename Enable = void>
+  struct word_query
+  { static bool constexpr const value{ false }; };
+
+  template <typename Volume>
+  struct word_query<Volume, decltype(void(std::declval<Volume const&>().get_bits(
+                                     size_t{}, size_t{}, size_t{})))>
+  { static bool constexpr const value{ true }; };
+}
@@ -0,0 +1,243 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: terrain_renderable.cpp
+  Author: Jesse 'Jeaye' Wilkerson
+*/
+
+#include "terrain_renderable.h"
+
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#include <OgreHardwareBufferManager.h>
+#include <OgreCamera.h>
+#include <OgreSceneNode.h>
+
+terrain_renderable::terrain_renderable(format const fmt)
+  : m_format(fmt)
+{
+  mRenderOp.operationType = Ogre::RenderOperation::OT_TRIANGLE_LIST;
+  mRenderOp.useIndexes = false;
+  mRenderOp.vertexData = new Ogre::VertexData;
+  mRenderOp.vertexData->vertexCount = 0;
+  mRenderOp.indexData = new Ogre::IndexData;
+  mRenderOp.indexData->indexCount = 0;
+
+  auto * const decl(mRenderOp.vertexData->vertexDeclaration);
+  size_t offset{};
+  if(m_format == format::compact)
+  {
+    /* The normal rides in the colour; it's the only four byte
+     * attribute every render system takes. */
+    offset += decl->addElement(0, offset, Ogre::VET_SHORT4, Ogre::VES_POSITION).getSize();
+    decl->addElement(0, offset, Ogre::VET_COLOUR_ABGR, Ogre::VES_DIFFUSE);
+    setMaterial("splat_compact");
+  }
+  else
+  {
+    offset += decl->addElement(0, offset, Ogre::VET_FLOAT3, Ogre::VES_POSITION).getSize();
+    offset += decl->addElement(0, offset, Ogre::VET_FLOAT3, Ogre::VES_NORMAL).getSize();
+    offset += decl->addElement(0, offset, Ogre::VET_COLOUR_ABGR, Ogre::VES_DIFFUSE).getSize();
+    decl->addElement(0, offset, Ogre::VET_FLOAT2, Ogre::VES_TEXTURE_COORDINATES, 0);
+    setMaterial("splat");
+  }
+}
+
+terrain_renderable::~terrain_renderable()
+{
+  delete mRenderOp.vertexData;
+  delete mRenderOp.indexData;
+}
+
+namespace
+{
+  /* vertex(i) is the i'th of the count vertices to pack. The height
+   * ramp is picked with selects rather than branches. */
+  template <typename Vertices>
+  void pack_full(Vertices const &vertex, size_t const count, float const size,
+                 Ogre::Vector3 const &origin, terrain_renderable::vertex *out,
+                 Ogre::AxisAlignedBox &bounds)
+  {
+    if(count == 0)
+    { return; }
+
+    auto const channel([](float const v)
+    { return static_cast<uint32_t>(std::min(std::max(v, 0.0f), 1.0f) * 255.0f + 0.5f); });
+
+    float const ramp{ 1.0f / (size * 0.3f) };
+    float const high{ size * 0.2f }, mid{ size * 0.1f };
+    auto const &first(vertex(0).p);
+    float lower[3]{ first.x, first.y, first.z };
+    float upper[3]{ first.x, first.y, first.z };
+    for(size_t i{}; i < count; ++i)
+    {
+      auto const &p(vertex(i).p);
+      auto const &n(vertex(i).n);
+      auto &v(out[i]);
+      v.position[0] = p.x - origin.x;
+      v.position[1] = p.y - origin.y;
+      v.position[2] = p.z - origin.z;
+      v.normal[0] = n.x; v.normal[1] = n.y; v.normal[2] = n.z;
+      v.uv[0] = p.x * 0.001f;
+      v.uv[1] = p.z * 0.001f;
+
+      float const h{ std::min(1.0f, p.y * ramp) };
+      float const h_inv{ std::max(0.0f, 0.3f - h) };
+      bool const is_high{ p.y > high }, is_mid{ p.y > mid };
+      float const r{ is_mid ? h : 0.0f };
+      float const g{ is_high ? h_inv : r };
+      float const b{ is_mid ? 0.0f : h };
+      v.colour = channel(r) | (channel(g) << 8) | (channel(b) << 16) | 0xff000000u;
+
+      lower[0] = std::min(lower[0], p.x); upper[0] = std::max(upper[0], p.x);
+      lower[1] = std::min(lower[1], p.y); upper[1] = std::max(upper[1], p.y);
+      lower[2] = std::min(lower[2], p.z); upper[2] = std::max(upper[2], p.z);
+    }
+    bounds.merge(Ogre::AxisAlignedBox{ lower[0] - origin.x, lower[1] - origin.y,
+                                       lower[2] - origin.z, upper[0] - origin.x,
+                                       upper[1] - origin.y, upper[2] - origin.z });
+  }
+
+  template <typename Vertices>
+  void merge_bounds(Vertices const &vertex, size_t const count, Ogre::Vector3 const &origin,
+                    Ogre::AxisAlignedBox &bounds)
+  {
+    if(count == 0)
+    { return; }
+
+    auto const &first(vertex(0).p);
+    Ogre::Vector3 lower{ first.x, first.y, first.z }, upper{ lower };
+    for(size_t i{}; i < count; ++i)
+    {
+      auto const &v(vertex(i).p);
+      Ogre::Vector3 const p{ v.x, v.y, v.z };
+      lower.makeFloor(p);
+      upper.makeCeil(p);
+    }
+    bounds.merge(Ogre::AxisAlignedBox{ lower - origin, upper - origin });
+  }
+}
+
+void terrain_renderable::pack(vox::vertex_pn const *in, size_t const count, float const size,
+                              Ogre::Vector3 const &origin, vertex *out,
+                              Ogre::AxisAlignedBox &bounds)
+{
+  pack_full([in](size_t const i) -> vox::vertex_pn const& { return in[i]; },
+            count, size, origin, out, bounds);
+}
+
+void terrain_renderable::pack(vox::triangle_pn const *in, size_t const count, float const size,
+                              Ogre::Vector3 const &origin, vertex *out,
+                              Ogre::AxisAlignedBox &bounds)
+{
+  pack_full([in](size_t const i) -> vox::vertex_pn const& { return in[i / 3].verts[i % 3]; },
+            count * 3, size, origin, out, bounds);
+}
+
+void terrain_renderable::pack(vox::vertex_pn const *in, size_t const count,
+                              Ogre::Vector3 const &origin, float const step,
+                              vox::vertex_q *out, Ogre::AxisAlignedBox &bounds)
+{
+  vox::quantize::pack(in, count, { origin.x, origin.y, origin.z }, step, out);
+  merge_bounds([in](size_t const i) -> vox::vertex_pn const& { return in[i]; },
+               count, origin, bounds);
+}
+
+void terrain_renderable::pack(vox::triangle_pn const *in, size_t const count,
+                              Ogre::Vector3 const &origin, float const step,
+                              vox::vertex_q *out, Ogre::AxisAlignedBox &bounds)
+{
+  for(size_t t{}; t < count; ++t)
+  { vox::quantize::pack(in[t].verts, 3, { origin.x, origin.y, origin.z }, step, out + t * 3); }
+  merge_bounds([in](size_t const i) -> vox::vertex_pn const& { return in[i / 3].verts[i % 3]; },
+               count * 3, origin, bounds);
+}
+
+void terrain_renderable::reserve(size_t const vertices, size_t const indices)
+{
+  auto &mgr(Ogre::HardwareBufferManager::getSingleton());
+  if(vertices > m_vertex_capacity)
+  {
+    m_vertex_capacity = vertices;
+    m_vertices = mgr.createVertexBuffer(get_vertex_size(), m_vertex_capacity,
+                                        Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
+    mRenderOp.vertexData->vertexBufferBinding->setBinding(0, m_vertices);
+  }
+  if(indices > m_index_capacity)
+  {
+    m_index_capacity = indices;
+    m_indices = mgr.createIndexBuffer(Ogre::HardwareIndexBuffer::IT_32BIT, m_index_capacity,
+                                      Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
+    mRenderOp.indexData->indexBuffer = m_indices;
+  }
+}
+
+void terrain_renderable::write_vertices(void const *data, size_t const first,
+                                        size_t const count)
+{
+  if(count == 0)
+  { return; }
+
+  /* Writes after the first don't touch what came before. */
+  size_t const size{ get_vertex_size() };
+  auto * const dest(m_vertices->lock(first * size, count * size,
+                                     first ? Ogre::HardwareBuffer::HBL_NO_OVERWRITE
+                                           : Ogre::HardwareBuffer::HBL_DISCARD));
+  std::memcpy(dest, data, count * size);
+  m_vertices->unlock();
+}
+
+void terrain_renderable::write_indices(uint32_t const *data, size_t const first,
+                                       size_t const count)
+{
+  if(count == 0)
+  { return; }
+
+  auto * const dest(m_indices->lock(first * sizeof(uint32_t), count * sizeof(uint32_t),
+                                    first ? Ogre::HardwareBuffer::HBL_NO_OVERWRITE
+                                          : Ogre::HardwareBuffer::HBL_DISCARD));
+  std::memcpy(dest, data, count * sizeof(uint32_t));
+  m_indices->unlock();
+}
+
+void terrain_renderable::commit(size_t const vertices, size_t const indices,
+                                Ogre::AxisAlignedBox const &bounds, float const step)
+{
+  /* Read by the compact shaders as custom parameter 0. */
+  setCustomParameter(0, Ogre::Vector4(step, step, step, 1.0f));
+  mRenderOp.vertexData->vertexStart = 0;
+  mRenderOp.vertexData->vertexCount = vertices;
+  mRenderOp.useIndexes = indices != 0;
+  mRenderOp.indexData->indexStart = 0;
+  mRenderOp.indexData->indexCount = indices;
+  setBoundingBox(bounds);
+  if(mParentNode)
+  { mParentNode->needUpdate(); }
+}
+
+/* Ogre centres the sphere on the node, which sits at the chunk's
+ * lower corner rather than the middle of its box; the farthest
+ * corner takes whichever face is farther along each axis. */
+Ogre::Real terrain_renderable::getBoundingRadius() const
+{
+  if(!mBox.isFinite())
+  { return 0.0f; }
+
+  auto const &lower(mBox.getMinimum());
+  auto const &upper(mBox.getMaximum());
+  return Ogre::Vector3(std::max(std::abs(lower.x), std::abs(upper.x)),
+                       std::max(std::abs(lower.y), std::abs(upper.y)),
+                       std::max(std::abs(lower.z), std::abs(upper.z))).length();
+}
+
+Ogre::Real terrain_renderable::getSquaredViewDepth(Ogre::Camera const *cam) const
+{
+  auto centre(mBox.isFinite() ? mBox.getCenter() : Ogre::Vector3::ZERO);
+  if(mParentNode)
+  { centre += mParentNode->_getDerivedPosition(); }
+  return (cam->getDerivedPosition() - centre).squaredLength();
+}
@@ -0,0 +1,96 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: terrain_renderable.h
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    Terrain geometry kept in hardware buffers of packed,
+    interleaved vertices. Meshes are packed once, off the
+    render thread, then copied in with a lock and memcpy
+    per write; nothing is built a vertex at a time. Each
+    chunk of terrain gets one, so it's culled on its own.
+    Compact renderables take vox::vertex_q instead, a
+    third of the size, and use the splat_compact material,
+    whose shaders decode them.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <OgreSimpleRenderable.h>
+#include <OgreHardwareVertexBuffer.h>
+#include <OgreHardwareIndexBuffer.h>
+#include <OgreAxisAlignedBox.h>
+
+#include "vox/vertex.h"
+#include "vox/triangle.h"
+#include "vox/quantize.h"
+
+class terrain_renderable : public Ogre::SimpleRenderable
+{
+  public:
+    /* Matches the vertex declaration; colour is VET_COLOUR_ABGR. */
+    struct vertex
+    {
+      float position[3];
+      float normal[3];
+      uint32_t colour;
+      float uv[2];
+    };
+
+    enum class format
+    {
+      full,
+      compact
+    };
+
+    explicit terrain_renderable(format const fmt = format::full);
+    ~terrain_renderable();
+
+    terrain_renderable(terrain_renderable const &) = delete;
+    terrain_renderable& operator =(terrain_renderable const &) = delete;
+
+    /* Packs count vertices into out, relative to origin, coloured by
+     * height within a terrain of the given size, and grows bounds
+     * around them, also relative to origin. */
+    static void pack(vox::vertex_pn const *in, size_t const count, float const size,
+                     Ogre::Vector3 const &origin, vertex *out, Ogre::AxisAlignedBox &bounds);
+    /* The same, for compact renderables; positions are in steps
+     * of step, which commit() needs to be told. */
+    static void pack(vox::vertex_pn const *in, size_t const count, Ogre::Vector3 const &origin,
+                     float const step, vox::vertex_q *out, Ogre::AxisAlignedBox &bounds);
+    /* Both, for count triangles, packed into 3 * count vertices. */
+    static void pack(vox::triangle_pn const *in, size_t const count, float const size,
+                     Ogre::Vector3 const &origin, vertex *out, Ogre::AxisAlignedBox &bounds);
+    static void pack(vox::triangle_pn const *in, size_t const count, Ogre::Vector3 const &origin,
+                     float const step, vox::vertex_q *out, Ogre::AxisAlignedBox &bounds);
+
+    /* Makes room for a mesh; the buffers only ever grow. What's
+     * shown doesn't change until commit(). */
+    void reserve(size_t const vertices, size_t const indices);
+    /* data holds vertex or vox::vertex_q, matching the format. */
+    void write_vertices(void const *data, size_t const first, size_t const count);
+    void write_indices(uint32_t const *data, size_t const first, size_t const count);
+    /* Draws the first vertices and indices written; without
+     * indices, the vertices are a list of triangles. */
+    void commit(size_t const vertices, size_t const indices,
+                Ogre::AxisAlignedBox const &bounds, float const step = 1.0f);
+
+    format get_format() const
+    { return m_format; }
+    size_t get_vertex_size() const
+    { return m_format == format::compact ? sizeof(vox::vertex_q) : sizeof(vertex); }
+
+    Ogre::Real getBoundingRadius() const override;
+    Ogre::Real getSquaredViewDepth(Ogre::Camera const *cam) const override;
+
+  private:
+    format const m_format;
+    Ogre::HardwareVertexBufferSharedPtr m_vertices;
+    Ogre::HardwareIndexBufferSharedPtr m_indices;
+    size_t m_vertex_capacity{}, m_index_capacity{};
+};
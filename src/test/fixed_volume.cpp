@@ -0,0 +1,137 @@
+/*
+  Copyright 2013 Jesse 'Jeaye' Wilkerson
+  See licensing in LICENSE file, or at:
+    http://www.opensource.org/licenses/BSD-3-Clause
+
+  File: test/fixed_volume.cpp
+  Author: Jesse 'Jeaye' Wilkerson
+  Description:
+    Checks that writes which bypass set(), through
+    vol(x, y, z), vol[x][y][z] and the raw runs, are seen
+    by both extractors, with or without a touch() after.
+    Each volume is compared against one written through
+    set(), whose ranges are always kept up to date.
+*/
+
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <functional>
+
+#include "vox/fixed_volume.h"
+#include "vox/surface_extractor.h"
+#include "vox/surface_net_extractor.h"
+#include "vox/triangle.h"
+#include "vox/vertex.h"
+
+namespace
+{
+  using volume_t = vox::fixed_volume<uint8_t>;
+  using extractor_t = vox::surface_extractor<vox::triangle_p, volume_t>;
+  using net_extractor_t = vox::surface_net_extractor<vox::vertex_p, volume_t>;
+  using write_t = std::function<void (volume_t&, size_t const, size_t const,
+                                      size_t const, uint8_t const)>;
+
+  int32_t const size{ 48 };
+  uint8_t const iso_level{ 128 };
+
+  uint8_t sample(size_t const x, size_t const y, size_t const z)
+  {
+    float const height{ 20.0f + 8.0f * std::sin(x * 0.21f) * std::cos(z * 0.17f) };
+    float const hole{ std::sqrt((x - 24.0f) * (x - 24.0f) + (y - 14.0f) * (y - 14.0f) +
+                                (z - 24.0f) * (z - 24.0f)) };
+    return (y < height && hole > 7.0f) ? 255 : 0;
+  }
+
+  void write(volume_t &vol, write_t const &func)
+  {
+    for(size_t x{}; x < static_cast<size_t>(size); ++x)
+    {
+      for(size_t y{}; y < static_cast<size_t>(size); ++y)
+      {
+        for(size_t z{}; z < static_cast<size_t>(size); ++z)
+        { func(vol, x, y, z, sample(x, y, z)); }
+      }
+    }
+  }
+
+  struct mesh
+  {
+    size_t triangles{}, vertices{};
+    double sum{};
+  };
+
+  mesh extract(volume_t const &vol, size_t const unit)
+  {
+    mesh m;
+    auto const surface(extractor_t{ vol, vol.get_region(), iso_level, unit }());
+    for(auto const &tri : surface.get_triangles())
+    {
+      ++m.triangles;
+      for(auto const &v : tri.verts)
+      { m.sum += v.p.x + v.p.y * 3.0 + v.p.z * 7.0; }
+    }
+    auto const net(net_extractor_t{ vol, vol.get_region(), iso_level, unit }());
+    m.vertices = net.get_vertices().size();
+    return m;
+  }
+
+  bool check(char const * const name, volume_t const &vol, volume_t const &expected)
+  {
+    bool ok{ true };
+    for(size_t unit{ 1 }; unit <= 4; unit *= 2)
+    {
+      auto const got(extract(vol, unit)), want(extract(expected, unit));
+      if(want.triangles == 0 || got.triangles != want.triangles ||
+         got.sum != want.sum || got.vertices != want.vertices)
+      {
+        std::printf("%s, unit %zu: %zu triangles and %zu net vertices, expected %zu and %zu\n",
+                    name, unit, got.triangles, got.vertices, want.triangles, want.vertices);
+        ok = false;
+      }
+    }
+    return ok;
+  }
+}
+
+int main()
+{
+  vox::region const reg{ { 0, 0, 0 }, { size, size, size } };
+  volume_t expected(reg);
+  write(expected, [](volume_t &vol, size_t const x, size_t const y, size_t const z,
+                     uint8_t const value)
+  { vol.set(x, y, z, value); });
+
+  volume_t call(reg);
+  write(call, [](volume_t &vol, size_t const x, size_t const y, size_t const z,
+                 uint8_t const value)
+  { vol(x, y, z) = value; });
+
+  volume_t index(reg);
+  write(index, [](volume_t &vol, size_t const x, size_t const y, size_t const z,
+                  uint8_t const value)
+  { vol[x][y][z] = value; });
+
+  volume_t runs(reg);
+  write(runs, [](volume_t &vol, size_t const x, size_t const y, size_t const z,
+                 uint8_t const value)
+  { vol.run(x, y)[z] = value; });
+
+  bool ok{ true };
+  ok &= check("vol(x, y, z)", call, expected);
+  ok &= check("vol[x][y][z]", index, expected);
+  ok &= check("run(x, y)", runs, expected);
+
+  /* Once touched, the ranges are trusted again. */
+  call.touch(reg);
+  ok &= check("vol(x, y, z), touched", call, expected);
+
+  /* A write after the touch makes them stale once more. */
+  expected.set(24, 42, 24, 255);
+  call(24, 42, 24) = 255;
+  ok &= check("vol(x, y, z), written after touch", call, expected);
+
+  if(!ok)
+  { return 1; }
+  std::printf("ok\n");
+}